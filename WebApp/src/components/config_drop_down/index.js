@@ -22,7 +22,7 @@ const ConfigDropDown = ({
         ["Hue", "Formants", "Moving"],
         ["Default", "Sections", "Talk"],
         ["Basic", "Advanced", "Formant"],
-        ["Default"],
+        ["Default", "Log Bands"],
         ["Default"],
         ["Frequency", "Volume"],
         ["Default"],
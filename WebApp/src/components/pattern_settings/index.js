@@ -11,6 +11,13 @@ import RANGE_CONSTANTS from '../../utils/constants';
 import style from './style.css';
 import MultiRangeSliderWrapper from '../../components/multi_range_slider';
 import ConfigDropDown from "../config_drop_down";
+import Select from 'preact-material-components/Select';
+
+// Blend modes, in the order the device numbers them.
+const BLEND_MODES = ["Normal", "Add", "Screen", "Max", "Multiply"];
+
+// Color palettes, in the order the device numbers them.
+const PALETTES = ["Hot", "Hue", "Evil", "Forest"];
 
 /**
  * @brief An object meant to hold and display settings for a specific pattern
@@ -37,7 +44,10 @@ const PatternSettings = ({num, patterns}) => {
 		brightness: 255,
 		smoothing: 0,
 		postprocess: 0,
-		config: 0
+		config: 0,
+		opacity: 255,
+		blend: 0,
+		palette: 0
 	});
 
 	/**
@@ -122,6 +132,32 @@ const PatternSettings = ({num, patterns}) => {
 				structure_ref="smoothing"
 				update={update}
 			/>
+			<br/>
+			<NumericSlider
+				className={style.settings_control}
+				label="Layer Opacity"
+				min={RANGE_CONSTANTS.OPACITY_MIN}
+				max={RANGE_CONSTANTS.OPACITY_MAX}
+				initial={data.opacity}
+				structure_ref="opacity"
+				update={update}
+			/>
+			<div className={style.settings_control}>
+				<label>Layer Blend</label>
+				<Select
+					selectedIndex={data.blend}
+					onChange={(e) => update("blend", e.target.selectedIndex)}>
+					{BLEND_MODES.map((name) => <Select.Item>{name}</Select.Item>)}
+				</Select>
+			</div>
+			<div className={style.settings_control}>
+				<label>Color Palette</label>
+				<Select
+					selectedIndex={data.palette}
+					onChange={(e) => update("palette", e.target.selectedIndex)}>
+					{PALETTES.map((name) => <Select.Item>{name}</Select.Item>)}
+				</Select>
+			</div>
 			<div className={style.settings_control}>
                 <label for="reverse">Reverse</label>
 				<input 
@@ -29,7 +29,12 @@ const SystemControls = () => {
 	const [data, setData] = useState({
 		length: 60,
 		loop: 40,
-		debug: 0
+		debug: 0,
+		transition: 500,
+		layout: 0,
+		layout_width: 0,
+		rotation: 0,
+		channels: [0, 0]
 	});
 
 	/**
@@ -73,6 +78,17 @@ const SystemControls = () => {
 		setUpdated(true);
 	}
 
+	/**
+	 * @brief Updates the length of one output channel.
+	 * @param channel The index of the channel to update
+	 * @param value The new length of the channel, where 0 takes the rest of the strip
+	 */
+	const updateChannel = (channel, value) => {
+		const channels = [...data.channels];
+		channels[channel] = value;
+		update("channels", channels);
+	}
+
 	/**
 	 * @brief Generates the UI element for adjusting system settings.
 	 */
@@ -99,6 +115,68 @@ const SystemControls = () => {
 					update={update}
 				/>
 				<br/>
+				<NumericSlider
+					className={style.settings_control}
+					label="Pattern Transition Time (ms)"
+					min={RANGE_CONSTANTS.TRANSITION_MIN}
+					max={RANGE_CONSTANTS.TRANSITION_MAX}
+					initial={data.transition}
+					structure_ref="transition"
+					update={update}
+				/>
+				<br/>
+				{data.channels.map((length, channel) =>
+					<div>
+						<NumericSlider
+							className={style.settings_control}
+							label={`Output ${channel + 1} Length (0 for the rest of the strip)`}
+							min={RANGE_CONSTANTS.CHANNEL_LENGTH_MIN}
+							max={RANGE_CONSTANTS.CHANNEL_LENGTH_MAX}
+							initial={length}
+							structure_ref={channel}
+							update={updateChannel}
+						/>
+						<br/>
+					</div>
+				)}
+				<SimpleChooser
+					className={style.settings_control}
+					label="LED Layout"
+					options={[
+						{option : "Rows", idx : 1},
+						{option : "Serpentine", idx : 2},
+						{option : "Custom Map", idx : 3},
+					]}
+					noSelection={true}
+					initial={data.layout}
+					structure_ref="layout"
+					update={update}	
+				/>
+				<br/>
+				<NumericSlider
+					className={style.settings_control}
+					label="Matrix Width"
+					min={RANGE_CONSTANTS.LAYOUT_WIDTH_MIN}
+					max={RANGE_CONSTANTS.LAYOUT_WIDTH_MAX}
+					initial={data.layout_width}
+					structure_ref="layout_width"
+					update={update}
+				/>
+				<br/>
+				<SimpleChooser
+					className={style.settings_control}
+					label="Matrix Rotation"
+					options={[
+						{option : "90 Degrees", idx : 1},
+						{option : "180 Degrees", idx : 2},
+						{option : "270 Degrees", idx : 3},
+					]}
+					noSelection={true}
+					initial={data.rotation}
+					structure_ref="rotation"
+					update={update}	
+				/>
+				<br/>
 				<SimpleChooser
 					className={style.settings_control}
 					label="Debug Mode"
@@ -12,6 +12,9 @@ const RANGE_CONSTANTS = {
     ALPHA_MAX : 255,
     ALPHA_MIN : 0,
 
+    OPACITY_MAX : 255,
+    OPACITY_MIN : 0,
+
     NOISE_MAX : 100,
     NOISE_MIN : 0,
 
@@ -22,7 +25,16 @@ const RANGE_CONSTANTS = {
     LOOP_MIN : 15,
 
     LENGTH_MIN : 30,
-    LENGTH_MAX : 200,
+    LENGTH_MAX : 1500,
+
+    TRANSITION_MIN : 0,
+    TRANSITION_MAX : 2000,
+
+    CHANNEL_LENGTH_MIN : 0,
+    CHANNEL_LENGTH_MAX : 1500,
+
+    LAYOUT_WIDTH_MIN : 0,
+    LAYOUT_WIDTH_MAX : 1500,
 
     SAVE_COUNT : 3,
     PATTERN_MAX : 4,
@@ -93,9 +93,14 @@ inline void handle_pattern_get_request(AsyncWebServerRequest* request) {
   String maxhue = String(", \"hue_max\": ") + p.maxhue;
   String conf = String(", \"config\": ") + p.config;
   String postprocess = String(", \"postprocess\": ") + p.postprocessing_mode;
+  String band_low = String(", \"band_low\": ") + (p.band_low * SAMPLING_FREQUENCY / SAMPLES);
+  String band_high = String(", \"band_high\": ") + (p.band_high * SAMPLING_FREQUENCY / SAMPLES);
+  String opacity = String(", \"opacity\": ") + p.opacity;
+  String blend = String(", \"blend\": ") + p.blend_mode;
+  String palette = String(", \"palette\": ") + p.palette;
 
   // Build and send the final response
-  const String response = String("{") + idx + bright + smooth + minhue + maxhue + conf + postprocess + String(" }");
+  const String response = String("{") + idx + bright + smooth + minhue + maxhue + conf + postprocess + band_low + band_high + opacity + blend + palette + String(" }");
   request->send(HTTP_OK, CONTENT_JSON, response);
 }
 
@@ -187,9 +192,15 @@ inline void handle_pattern_put_request(AsyncWebServerRequest* request, JsonVaria
     const uint8_t maxhue = payload["hue_max"];
     const uint8_t conf = payload["config"];
     const uint8_t postprocess = payload["postprocess"];
+    const uint8_t opacity = payload["opacity"] | 255;
+    const uint8_t blend = payload["blend"];
+    const uint8_t palette = payload["palette"];
 
-    if(idx != loaded_patterns.pattern[pattern_num].idx)
-      pattern_changed = true;
+    // Band focus is sent in Hz and stored as FFT bins.
+    const uint16_t band_low_hz = payload["band_low"];
+    const uint16_t band_high_hz = payload["band_high"];
+    uint8_t band_low = min(band_low_hz * SAMPLES / SAMPLING_FREQUENCY, SAMPLES/2 - 1);
+    uint8_t band_high = min(band_high_hz * SAMPLES / SAMPLING_FREQUENCY, SAMPLES/2 - 1);
 
     loaded_patterns.pattern[pattern_num].idx = idx;
     loaded_patterns.pattern[pattern_num].brightness = bright;
@@ -198,6 +209,11 @@ inline void handle_pattern_put_request(AsyncWebServerRequest* request, JsonVaria
     loaded_patterns.pattern[pattern_num].maxhue = maxhue;
     loaded_patterns.pattern[pattern_num].config = conf;
     loaded_patterns.pattern[pattern_num].postprocessing_mode = postprocess;
+    loaded_patterns.pattern[pattern_num].band_low = band_low;
+    loaded_patterns.pattern[pattern_num].band_high = band_high;
+    loaded_patterns.pattern[pattern_num].opacity = opacity;
+    loaded_patterns.pattern[pattern_num].blend_mode = (blend < NUM_BLEND_MODES) ? blend : BLEND_NORMAL;
+    loaded_patterns.pattern[pattern_num].palette = (palette < NUM_PALETTES) ? palette : PALETTE_HOT;
 
     manual_control_enabled = false;
 
@@ -323,20 +339,46 @@ inline void handle_system_settings_put_request(AsyncWebServerRequest* request, J
 
     int status = HTTP_OK;
 
-    uint8_t length = payload["length"];
+    uint16_t length = payload["length"];
     uint8_t loop = payload["loop"];
     uint8_t debug = payload["debug"];
+    uint16_t transition = payload["transition"] | config.transition_ms;
+    uint8_t layout = payload["layout"] | config.layout;
+    uint16_t layout_width = payload["layout_width"] | config.layout_width;
+    uint8_t rotation = payload["rotation"] | config.layout_rotation;
+    const JsonArray& channel_lengths = payload["channels"].as<JsonArray>();
 
-    bound_byte(&length, 30, MAX_LEDS);
+    bound_word(&length, MIN_LEDS, MAX_LEDS);
     bound_byte(&loop, 15, 100);
     bound_byte(&debug, 0, 2);
+    bound_byte(&layout, 0, NUM_LAYOUTS - 1);
+    bound_word(&layout_width, 0, MAX_LEDS);
+    bound_byte(&rotation, 0, 3);
 
     if(config.length != length)
       pattern_changed = true;
 
+    if(config.layout != layout || config.layout_width != layout_width || config.layout_rotation != rotation)
+      pattern_changed = true;
+
+    // Channels missing from the request keep their length.
+    uint16_t channels[OUTPUT_CHANNELS];
+    for(int i = 0; i < OUTPUT_CHANNELS; i++){
+      channels[i] = channel_lengths[i] | config.channel_length[i];
+      bound_word(&channels[i], 0, MAX_LEDS);
+
+      if(config.channel_length[i] != channels[i])
+        pattern_changed = true;
+    }
+
     config.length = length;
     config.loop_ms = loop;
     config.debug_mode = debug;
+    config.transition_ms = min(transition, (uint16_t) MAX_TRANSITION_MS);
+    config.layout = layout;
+    config.layout_width = layout_width;
+    config.layout_rotation = rotation;
+    memcpy(config.channel_length, channels, sizeof(channels));
 
     save_config_to_nvs();
 
@@ -355,16 +397,88 @@ inline void handle_system_settings_put_request(AsyncWebServerRequest* request, J
 /// @brief Handler function for getting system settings.
 /// @param request The incoming get request
 ///
-/// Includes data such as strip length, loop times, and debug mode.
+/// Includes data such as strip length, loop times, debug mode,
+/// pattern transition time, pixel layout, and output channel lengths.
 inline void handle_system_settings_get_request(AsyncWebServerRequest* request) {
 
   // Create response substrings
   String length = String(" \"length\": ") + config.length;
   String loop = String(", \"loop\": ") + config.loop_ms;
   String debug = String(", \"debug\": ") + config.debug_mode;
+  String transition = String(", \"transition\": ") + config.transition_ms;
+  String layout = String(", \"layout\": ") + config.layout;
+  String layout_width = String(", \"layout_width\": ") + config.layout_width;
+  String rotation = String(", \"rotation\": ") + config.layout_rotation;
+
+  String channels = String(", \"channels\": [");
+  for(int i = 0; i < OUTPUT_CHANNELS; i++)
+    channels += String((i) ? ", " : "") + config.channel_length[i];
+  channels += "]";
+
+  // Build and send the final response
+  const String response = String("{") + length + loop + debug + transition + layout + layout_width + rotation + channels + String(" }");
+  request->send(HTTP_OK, CONTENT_JSON, response);
+}
+
+/// @brief Handler function for uploading a custom pixel layout.
+/// @param request The incoming put request
+/// @param json    The incoming JSON file holding the new layout map
+///
+/// The map is an array holding the physical pixel every logical
+/// pixel is wired to, in logical order. It is used while the
+/// layout setting is custom.
+inline void handle_layout_map_put_request(AsyncWebServerRequest* request, JsonVariant& json) {
+  if (request->method() == HTTP_PUT) {
+    const JsonArray& map = json["map"].as<JsonArray>();
+
+    // Sized by the upload, as a full map is too large for the stack.
+    uint16_t size = min(map.size(), (size_t) MAX_LEDS);
+    uint16_t * layout_map = (uint16_t *) malloc(sizeof(uint16_t) * size);
+    if (!layout_map) {
+      request->send(HTTP_INTERNAL_ERROR);
+      return;
+    }
+
+    uint16_t len = 0;
+    for (JsonVariant pixel : map) {
+      if (len >= size) break;
+      layout_map[len++] = pixel.as<uint16_t>();
+    }
+
+    set_custom_layout(layout_map, len);
+    free(layout_map);
+    pattern_changed = true;
+
+    request->send(
+      HTTP_OK,
+      CONTENT_TEXT,
+      build_response(
+        true,
+        "success",
+        nullptr));
+  } else {
+    request->send(HTTP_METHOD_NOT_ALLOWED);
+  }
+}
+
+/// @brief Handler function for getting diagnostics.
+/// @param request The incoming get request
+///
+/// Includes the number of frames rendered by the loop, the number
+/// sent to the LED strip, the number skipped because the frame
+/// had not changed, and how long the last frame took to send.
+inline void handle_diagnostics_get_request(AsyncWebServerRequest* request) {
+
+  const Output_Stats * stats = get_output_stats();
+
+  // Create response substrings
+  String rendered = String(" \"frames_rendered\": ") + stats->rendered;
+  String shown = String(", \"frames_shown\": ") + stats->shown;
+  String skipped = String(", \"frames_skipped\": ") + stats->skipped;
+  String send = String(", \"send_us\": ") + stats->send_us;
 
   // Build and send the final response
-  const String response = String("{") + length + loop + debug + String(" }");
+  const String response = String("{") + rendered + shown + skipped + send + String(" }");
   request->send(HTTP_OK, CONTENT_JSON, response);
 }
 
@@ -440,8 +554,9 @@ APIGetHook apiGetHooks[] = {
   { "/api/getPattern", handle_pattern_get_request },
   { "/api/getStrip", handle_strip_get_request },
   { "/api/getSettings", handle_system_settings_get_request },
+  { "/api/getDiagnostics", handle_diagnostics_get_request },
 };
-constexpr int API_GET_HOOK_COUNT = 4;
+constexpr int API_GET_HOOK_COUNT = 5;
 
 /// The currently active put requests.
 APIPutHook apiPutHooks[] = {
@@ -451,5 +566,6 @@ APIPutHook apiPutHooks[] = {
   { "/api/save", handle_save_to_slot_put_request },
   { "/api/putSettings", handle_system_settings_put_request },
   { "/api/updatePassword", handle_new_password_put_request },
+  { "/api/putLayoutMap", handle_layout_map_put_request },
 };
-constexpr int API_PUT_HOOK_COUNT = 6;
+constexpr int API_PUT_HOOK_COUNT = 7;
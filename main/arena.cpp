@@ -0,0 +1,114 @@
+/** @file
+  *
+  * This file's functions manage the memory arena that LED
+  * buffers and pattern state are allocated from.
+  *
+*/
+
+#include <stdlib.h>
+#include <string.h>
+#include "arena.h"
+
+/// The memory handed out by arena_alloc().
+static uint8_t * arena = nullptr;
+
+/// The number of bytes the arena holds.
+static size_t arena_size = 0;
+
+/// The number of bytes currently allocated.
+static size_t arena_top = 0;
+
+/// The end of the blocks that live until the next setup.
+static size_t arena_base = 0;
+
+/// @brief Replaces the arena with an empty one of a new size.
+/// @param size The number of bytes the arena holds.
+/// @returns False if the memory could not be allocated, which
+/// leaves the arena empty.
+///
+/// Frees every allocation, including pinned ones. Anything
+/// still pointing into the arena must be reallocated.
+bool arena_setup(size_t size){
+  free(arena);
+
+  // malloc() aligns to at least ARENA_ALIGN on the ESP32.
+  arena = (uint8_t *) malloc(size);
+  arena_size = (arena) ? size : 0;
+  arena_top = 0;
+  arena_base = 0;
+
+  return arena != nullptr;
+}
+
+/// @brief Keeps every block allocated so far until the next setup.
+///
+/// Later resets and compactions leave these blocks in place.
+void arena_pin(){
+  arena_base = arena_top;
+}
+
+/// @brief Frees every allocation made since the arena was pinned.
+///
+/// Anything still pointing into those blocks must be dropped
+/// or reallocated after this is called.
+void arena_reset(){
+  arena_top = arena_base;
+}
+
+/// @brief Allocates a block of memory from the arena.
+/// @param size The number of bytes to allocate.
+/// @returns The allocated block, or nullptr if the arena is full.
+void * arena_alloc(size_t size){
+  size_t start = (arena_top + ARENA_ALIGN - 1) & ~(size_t) (ARENA_ALIGN - 1);
+
+  if(start + size > arena_size) return nullptr;
+
+  arena_top = start + size;
+  return &arena[start];
+}
+
+/// @brief Returns the number of bytes currently allocated.
+size_t arena_used(){
+  return arena_top;
+}
+
+/// @brief Moves live blocks down to close the gaps left by dropped ones.
+/// @param blocks Pointers to each live block's owning pointer, which
+///               is updated to the block's new address. Owners holding
+///               nullptr are skipped.
+/// @param sizes  The size of each block, in bytes.
+/// @param count  The number of blocks, up to ARENA_MAX_BLOCKS.
+///
+/// Every unpinned block that is still in use must be passed in.
+/// Blocks are moved with memmove, so they must not point into
+/// themselves.
+void arena_compact(void ** blocks[], const size_t sizes[], int count){
+
+  if(count > ARENA_MAX_BLOCKS) count = ARENA_MAX_BLOCKS;
+
+  // Order the live blocks by address, so each only ever moves down.
+  int order[ARENA_MAX_BLOCKS];
+  int live = 0;
+  for(int i = 0; i < count; i++){
+    if(!*blocks[i]) continue;
+
+    int j = live++;
+    while(j > 0 && *blocks[order[j - 1]] > *blocks[i]){
+      order[j] = order[j - 1];
+      j--;
+    }
+    order[j] = i;
+  }
+
+  size_t top = arena_base;
+  for(int k = 0; k < live; k++){
+    int i = order[k];
+    size_t start = (top + ARENA_ALIGN - 1) & ~(size_t) (ARENA_ALIGN - 1);
+
+    memmove(&arena[start], *blocks[i], sizes[i]);
+    *blocks[i] = &arena[start];
+    top = start + sizes[i];
+  }
+
+  arena_top = top;
+}
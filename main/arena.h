@@ -0,0 +1,37 @@
+/**@file
+ *
+ * This file contains function headers for arena.cpp.
+ *
+ * The arena is a block of memory that running patterns allocate
+ * their LED buffers and state from. It is sized for the strip
+ * length whenever the length changes, so short strips do not
+ * reserve memory for long ones.
+ *
+ * Allocations are never freed one by one. Blocks allocated
+ * before arena_pin() live until the arena is set up again.
+ * Blocks allocated after it are dropped all at once when the
+ * loaded patterns change, or compacted around the blocks still
+ * in use when a single pattern is replaced.
+ *
+**/
+
+#ifndef ARENA_H
+#define ARENA_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+/// Every allocation is aligned to this many bytes.
+#define ARENA_ALIGN 8
+
+/// The most blocks arena_compact() can move at once.
+#define ARENA_MAX_BLOCKS 8
+
+bool arena_setup(size_t size);
+void arena_pin();
+void arena_reset();
+void * arena_alloc(size_t size);
+size_t arena_used();
+void arena_compact(void ** blocks[], const size_t sizes[], int count);
+
+#endif
@@ -0,0 +1,162 @@
+/** @file
+  *
+  * This file's functions blur LED buffers in place.
+  *
+*/
+
+#include <FastLED.h>
+#include "blur.h"
+
+/// One box blur pass, run as a stage of a pipeline. Values are
+/// kept in Q8, so passes do not round to 8 bits between them.
+typedef struct{
+
+  /// The inputs inside the window, in Q8, oldest first from (oldest).
+  uint16_t ring[2 * BLUR_MAX_RADIUS + 1][3];
+
+  /// The sum of the window.
+  uint32_t sum[3];
+
+  /// The ring slot holding the oldest input.
+  uint8_t oldest;
+
+  /// The output for the last pixel, which stands in for every
+  /// output past the end.
+  uint16_t last[3];
+
+} Box_Stage;
+
+/// @brief Slides a full window one pixel along.
+/// @param s      The stage.
+/// @param v      The input, in Q8. Replaced by the stage's output.
+/// @param window The window width.
+/// @param reciprocal 1/window in Q16.
+static inline void stage_slide(Box_Stage * s, uint16_t v[3], int window, uint32_t reciprocal){
+  uint16_t * oldest = s->ring[s->oldest];
+  for (int c = 0; c < 3; c++) {
+    s->sum[c] += v[c] - oldest[c];
+    oldest[c] = v[c];
+    v[c] = (s->sum[c] * reciprocal + 32768) >> 16;
+  }
+  s->oldest = (s->oldest + 1 == window) ? 0 : s->oldest + 1;
+}
+
+/// @brief Feeds one input into a stage, near either end of the buffer.
+/// @param s      The stage.
+/// @param v      The input, in Q8. Replaced by the stage's output, if it has one.
+/// @param index  The input's pixel index.
+/// @param len    The number of pixels in the buffer.
+/// @param radius How many pixels on each side are averaged in.
+/// @param reciprocal 1/window in Q16.
+/// @returns The index of the pixel output, or -1 if there is none yet.
+///
+/// The first input fills the window with copies of itself, as if
+/// the first pixel were repeated past the start. Past the end, the
+/// output for the last pixel is repeated.
+static int stage_push(Box_Stage * s, uint16_t v[3], int index, int len, int radius,
+                      uint32_t reciprocal){
+
+  if (index == 0) {
+    for (int j = 0; j <= radius; j++)
+      for (int c = 0; c < 3; c++) s->ring[j][c] = v[c];
+    for (int c = 0; c < 3; c++) s->sum[c] = (uint32_t) v[c] * (radius + 1);
+    s->oldest = 0;
+  } else if (index <= radius) {
+    // The window fills up over the next (radius) pushes.
+    for (int c = 0; c < 3; c++) {
+      s->sum[c] += v[c];
+      s->ring[radius + index][c] = v[c];
+    }
+  }
+
+  int out = index - radius;
+  if (out < 0) return -1;
+
+  if (out >= len) {
+    for (int c = 0; c < 3; c++) v[c] = s->last[c];
+    return out;
+  }
+
+  if (out > 0) {
+    stage_slide(s, v, 2 * radius + 1, reciprocal);
+  } else {
+    for (int c = 0; c < 3; c++) v[c] = (s->sum[c] * reciprocal + 32768) >> 16;
+  }
+  for (int c = 0; c < 3; c++) s->last[c] = v[c];
+  return out;
+}
+
+/// @brief Reads a pixel into Q8.
+static inline void load(uint16_t v[3], CRGB px){
+  for (int c = 0; c < 3; c++) v[c] = px.raw[c] << 8;
+}
+
+/// @brief Writes a Q8 value back to a pixel, rounding it.
+static inline void store(CRGB * px, const uint16_t v[3]){
+  for (int c = 0; c < 3; c++) px->raw[c] = (v[c] + 128) >> 8;
+}
+
+/// @brief Runs every stage for one step of the sweep, near either end.
+/// @returns The index of the pixel the last stage output, or -1.
+static int sweep_step(Box_Stage * stages, uint16_t v[3], int t, int len, int radius,
+                      int passes, uint32_t reciprocal){
+  int out = -1;
+  for (int k = 0; k < passes; k++) {
+    int index = t - k * radius;
+    if (index < 0) return -1;
+    out = stage_push(&stages[k], v, index, len, radius, reciprocal);
+    if (out < 0) return -1;
+  }
+  return out;
+}
+
+/// @brief Blurs a buffer with repeated box blurs.
+/// @param leds   The buffer to blur.
+/// @param len    The number of pixels in the buffer.
+/// @param radius How many pixels on each side are averaged in, up to BLUR_MAX_RADIUS.
+/// @param passes How many times to blur, up to BLUR_MAX_PASSES. Two
+///               or three look close to a Gaussian blur.
+///
+/// All passes run in one sweep, each lagging the one before by
+/// (radius) pixels, and values stay in Q8 from one pass to the
+/// next. Pixels past either end count as copies of the end pixel
+/// in every pass, so the ends keep their brightness.
+void box_blur(CRGB * leds, int len, uint8_t radius, uint8_t passes){
+
+  if (len <= 1 || !radius || !passes) return;
+  radius = min(radius, (uint8_t) BLUR_MAX_RADIUS);
+  passes = min(passes, (uint8_t) BLUR_MAX_PASSES);
+
+  // Averages are taken by multiplying with 1/window in Q16. A full
+  // window of Q8 values times this still fits in 32 bits.
+  int window = 2 * radius + 1;
+  uint32_t reciprocal = (65536 + window / 2) / window;
+
+  Box_Stage stages[BLUR_MAX_PASSES];
+  int lag = passes * radius;
+  uint16_t v[3];
+  int t = 0;
+
+  // The first stage reads ahead of the pixel being written, so it
+  // always sees original pixels.
+  for (; t <= min(lag, len - 1); t++) {
+    load(v, leds[t]);
+    int out = sweep_step(stages, v, t, len, radius, passes, reciprocal);
+    if (out >= 0) store(&leds[out], v);
+  }
+
+  // Every window is full here, so each stage just slides.
+  for (; t < len; t++) {
+    load(v, leds[t]);
+    for (int k = 0; k < passes; k++) stage_slide(&stages[k], v, window, reciprocal);
+    store(&leds[t - lag], v);
+  }
+
+  // Past the end, the first stage keeps reading the last pixel.
+  CRGB end = leds[len - 1];
+  for (; t < len + lag; t++) {
+    load(v, end);
+    int out = sweep_step(stages, v, t, len, radius, passes, reciprocal);
+    if (out >= 0 && out < len) store(&leds[out], v);
+  }
+}
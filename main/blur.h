@@ -0,0 +1,29 @@
+/**@file
+ *
+ * This file contains function headers for blur.cpp.
+ *
+ * The box blur averages every pixel with its neighbors within a
+ * radius. It keeps a running sum, so a pass costs the same for
+ * any radius. Repeating it smooths the box into a bell shape.
+ *
+ * It only pays off for several passes or a radius above 1. A
+ * single pass of radius 1 is no faster than one blur1d() call,
+ * so keep using blur1d() for that.
+ *
+**/
+
+#ifndef BLUR_H
+#define BLUR_H
+
+#include <FastLED.h>
+
+/// The widest radius box_blur() averages over.
+#define BLUR_MAX_RADIUS 16
+
+/// The most passes box_blur() runs. Each pass keeps its own window
+/// on the stack, about 200 bytes.
+#define BLUR_MAX_PASSES 4
+
+void box_blur(CRGB * leds, int len, uint8_t radius, uint8_t passes);
+
+#endif
@@ -0,0 +1,81 @@
+/** @file
+  *
+  * This file's functions split frames between output channels
+  * and encode each channel's part of the frame.
+  *
+  * None of these functions touch the hardware. The SPI driver
+  * is only reached through the sink passed to send_channels().
+  *
+*/
+
+#include "channels.h"
+#include "sk9822.h"
+
+/// @brief Lays the channels out back to back along the strip.
+/// @param lengths The configured length of every channel.
+/// @param count   The number of channels.
+/// @param total   The number of LEDs in the frame.
+/// @param spans   Set to the span every channel sends.
+/// @returns The number of channels that send any LEDs.
+///
+/// A length of 0 takes the rest of the strip, and leaves nothing
+/// for the channels after it. Lengths running past the end of the
+/// strip are cut short.
+uint8_t split_channels(const uint16_t * lengths, uint8_t count, uint16_t total, Channel_Span * spans){
+
+  uint16_t offset = 0;
+  uint8_t active = 0;
+
+  for (uint8_t ch = 0; ch < count; ch++) {
+    uint16_t left = total - offset;
+    uint16_t len = (lengths[ch] && lengths[ch] < left) ? lengths[ch] : left;
+
+    spans[ch].offset = offset;
+    spans[ch].length = len;
+
+    offset += len;
+    if (len) active++;
+  }
+
+  return active;
+}
+
+/// @brief Returns the number of LEDs a channel sends from a frame.
+/// @param span The channel's span.
+/// @param len  The number of LEDs in the frame.
+///
+/// Spans are cut short by frames shorter than the strip they
+/// were laid out for.
+uint16_t channel_length(const Channel_Span * span, uint16_t len){
+  if (span->offset >= len) return 0;
+  return min(span->length, (uint16_t) (len - span->offset));
+}
+
+/// @brief Encodes every channel's part of a frame and sends it.
+/// @param frame      The frame covering every channel.
+/// @param len        The number of LEDs in the frame.
+/// @param spans      The span every channel sends.
+/// @param count      The number of channels.
+/// @param brightness The 5-bit global brightness sent to every LED.
+/// @param correction Color correction, scaling each channel by its value out of 255.
+/// @param sink       Where the encoded channels are sent.
+///
+/// Each channel is encoded while the ones before it are already
+/// being sent.
+void send_channels(const CRGB * frame, uint16_t len, const Channel_Span * spans, uint8_t count,
+                   uint8_t brightness, CRGB correction, const Channel_Sink * sink){
+
+  for (uint8_t ch = 0; ch < count; ch++) {
+    uint16_t n = channel_length(&spans[ch], len);
+    if (!n) continue;
+
+    size_t size = sk9822_frame_size(n);
+    uint8_t * out = sink->acquire(ch, size, sink->ctx);
+    if (!out) continue;
+
+    sk9822_encode(&frame[spans[ch].offset], n, brightness, correction, out, size);
+    sink->send(ch, out, size, sink->ctx);
+  }
+
+  sink->finish(sink->ctx);
+}
@@ -0,0 +1,55 @@
+/**@file
+ *
+ * This file contains function headers for channels.cpp
+ * along with the structures output channels are described by.
+ *
+ * One frame covers every output channel back to back. Each
+ * channel drives its own physical strip from a span of the
+ * frame, so strips refresh side by side instead of as one
+ * long chain.
+ *
+**/
+
+#ifndef CHANNELS_H
+#define CHANNELS_H
+
+#include <stddef.h>
+#include <FastLED.h>
+
+/// @brief The part of a frame one output channel sends.
+typedef struct{
+
+  uint16_t offset = 0; /// The first LED of the frame the channel sends.
+  uint16_t length = 0; /// The number of LEDs the channel sends.
+
+} Channel_Span;
+
+/// @brief Where encoded channels are sent.
+///
+/// The hardware sink starts a DMA transfer per channel in send()
+/// and waits on all of them in finish(), so channels go out in
+/// parallel. Any sink, such as one that records frames, can be
+/// used instead.
+typedef struct{
+
+  /// Returns a buffer of at least (size) bytes to encode channel
+  /// (ch) into, or nullptr to skip the channel.
+  uint8_t * (*acquire)(uint8_t ch, size_t size, void * ctx);
+
+  /// Starts sending an encoded channel. May return before the
+  /// transfer is done.
+  void (*send)(uint8_t ch, const uint8_t * data, size_t size, void * ctx);
+
+  /// Waits for every started transfer to finish.
+  void (*finish)(void * ctx);
+
+  void * ctx; /// Passed to every callback.
+
+} Channel_Sink;
+
+uint8_t split_channels(const uint16_t * lengths, uint8_t count, uint16_t total, Channel_Span * spans);
+uint16_t channel_length(const Channel_Span * span, uint16_t len);
+void send_channels(const CRGB * frame, uint16_t len, const Channel_Span * spans, uint8_t count,
+                   uint8_t brightness, CRGB correction, const Channel_Sink * sink);
+
+#endif
@@ -0,0 +1,286 @@
+/** @file
+  *
+  * This file's functions composite pattern buffers into the
+  * smoothed output buffer.
+  *
+  * Brightness, layering and smoothing are all linear, so they
+  * fold into one weight per source buffer. Each output pixel is
+  * then a weighted sum of its previous value and the sources,
+  * computed in 8.8 fixed point.
+  *
+  * Red and blue share one 32-bit word, one 16-bit lane each, so
+  * a pixel takes two multiplies per source instead of three.
+  * The weights always sum to 256, so a lane can never carry
+  * into its neighbor.
+  *
+  * Sources are read through a Pixel_View. The output is split
+  * into spans where every view reads its buffer with a fixed
+  * stride, and each span runs through the same kernel.
+  *
+  * Layer stacks that only use BLEND_NORMAL stay linear and take
+  * the same path. Other blend modes are not linear, so those
+  * stacks are accumulated per pixel in 16-bit channels, where
+  * 65535 is full intensity, before being smoothed into the output.
+  *
+*/
+
+#include "compositor.h"
+
+/// Rounds both 16-bit lanes of a packed sum to the nearest integer.
+#define LANE_ROUND 0x00800080
+
+/// @brief Converts an 8-bit fraction of 255 to an 8.8 fraction of 256.
+///
+/// 255 maps to exactly 256, so full brightness leaves pixels unchanged.
+static inline uint16_t to_q8(uint8_t x){
+  return x + (x >> 7);
+}
+
+/// @brief Packs the red and blue channels of a pixel into two 16-bit lanes.
+static inline uint32_t pack_rb(const CRGB & c){
+  return c.r | ((uint32_t) c.b << 16);
+}
+
+/// @brief Writes a packed red/blue sum and a green sum back to a pixel.
+static inline void unpack(CRGB & c, uint32_t rb, uint32_t g){
+  c.r = rb >> 8;
+  c.b = rb >> 24;
+  c.g = g >> 8;
+}
+
+/// @brief Finds where a view reads from at an output pixel.
+/// @param v       The view to read through.
+/// @param j       The output pixel.
+/// @param out_len The length of the output the view covers.
+/// @param src     Set to the first source pixel to read.
+/// @param stride  Set to the step between source pixels.
+/// @returns The number of output pixels, starting at j, that
+/// read the source with this stride.
+static int view_span(const Pixel_View * v, int j, int out_len,
+                     const CRGB ** src, int * stride){
+
+  int k, dir, span;
+
+  if (j < v->len) {
+    // Forward half, read in order.
+    k = j;
+    dir = 1;
+    span = v->len - j;
+  } else {
+    // Mirrored half, read back towards the start. When the output
+    // is odd, the middle pixel repeats the last rendered pixel.
+    int m = out_len - 1 - j;
+    if (m >= v->len) {
+      k = v->len - 1;
+      dir = 0;
+      span = 1;
+    } else {
+      k = m;
+      dir = -1;
+      span = m + 1;
+    }
+  }
+
+  if (v->reversed) {
+    k = v->len - 1 - k;
+    dir = -dir;
+  }
+
+  *src = v->leds + k;
+  *stride = dir;
+  return span;
+}
+
+/// @brief Blends one source into the output.
+/// @param out  The output pixels, also read as the previous frame.
+/// @param a    The first source pixel.
+/// @param sa   The step between source pixels.
+/// @param keep The 8.8 weight of the previous frame.
+/// @param wa   The 8.8 weight of the source. keep + wa must be at most 256.
+/// @param len  The number of pixels to composite.
+static void composite_pixels(CRGB * out, const CRGB * a, int sa,
+                             uint16_t keep, uint16_t wa, int len){
+  for (int i = 0; i < len; i++, a += sa) {
+    uint32_t rb = pack_rb(out[i]) * keep + pack_rb(*a) * wa + LANE_ROUND;
+    uint32_t g = out[i].g * keep + a->g * wa + 0x80;
+    unpack(out[i], rb, g);
+  }
+}
+
+/// @brief Blends any number of sources into the output.
+/// @param out     The output pixels, also read as the previous frame.
+/// @param src     The first pixel of every source.
+/// @param stride  The step between pixels of every source.
+/// @param weights The 8.8 weight of every source.
+/// @param count   The number of sources.
+/// @param keep    The 8.8 weight of the previous frame. All weights
+///                must sum to at most 256.
+/// @param len     The number of pixels to composite.
+static void composite_pixels(CRGB * out, const CRGB ** src, const int * stride,
+                             const uint16_t * weights, uint8_t count,
+                             uint16_t keep, int len){
+  for (int i = 0; i < len; i++) {
+    uint32_t rb = pack_rb(out[i]) * keep + LANE_ROUND;
+    uint32_t g = out[i].g * keep + 0x80;
+
+    for (uint8_t l = 0; l < count; l++) {
+      const CRGB * c = src[l] + i * stride[l];
+      rb += pack_rb(*c) * weights[l];
+      g += c->g * weights[l];
+    }
+
+    unpack(out[i], rb, g);
+  }
+}
+
+/// @brief Multiplies two 16-bit intensities, where 65535 is one.
+static inline uint16_t mul16(uint16_t a, uint16_t b){
+  return ((uint32_t) a * b + 65535) >> 16;
+}
+
+/// @brief Blends a layer's channel onto the channel below it.
+/// @param below The accumulated channel of the layers below.
+/// @param c     The layer's channel.
+/// @param mode  The layer's blend mode.
+/// @returns The blended channel, before opacity is applied.
+static inline uint16_t blend_channel(uint16_t below, uint16_t c, uint8_t mode){
+  switch (mode) {
+    case BLEND_ADD:
+      return min((uint32_t) below + c, (uint32_t) 65535);
+    case BLEND_SCREEN:
+      return below + c - mul16(below, c);
+    case BLEND_MAX:
+      return max(below, c);
+    case BLEND_MULTIPLY:
+      return mul16(below, c);
+    default:
+      return c;
+  }
+}
+
+/// @brief Blends a stack of layers with any blend modes into the output.
+/// @param out      The output pixels, also read as the previous frame.
+/// @param src      The first pixel of every layer.
+/// @param stride   The step between pixels of every layer.
+/// @param layers   The layers, from the bottom up.
+/// @param count    The number of layers.
+/// @param incoming The 8.8 weight of the new frame against the previous one.
+/// @param len      The number of pixels to composite.
+static void composite_blended(CRGB * out, const CRGB ** src, const int * stride,
+                              const Layer * layers, uint8_t count,
+                              uint16_t incoming, int len){
+
+  uint32_t bright[PATTERN_LIMIT];
+  uint16_t opacity[PATTERN_LIMIT];
+  for (uint8_t l = 0; l < count; l++) {
+    bright[l] = to_q8(layers[l].brightness) * 257;
+    opacity[l] = to_q8(layers[l].opacity);
+  }
+
+  uint16_t keep = 256 - incoming;
+
+  for (int i = 0; i < len; i++) {
+    uint16_t acc[3] = {0, 0, 0};
+
+    for (uint8_t l = 0; l < count; l++) {
+      const CRGB * c = src[l] + i * stride[l];
+
+      // The bottom layer always blends normally onto black.
+      uint8_t mode = (l) ? layers[l].blend_mode : BLEND_NORMAL;
+
+      for (uint8_t ch = 0; ch < 3; ch++) {
+        uint16_t v = (c->raw[ch] * bright[l]) >> 8;
+        uint16_t r = blend_channel(acc[ch], v, mode);
+        acc[ch] = ((uint32_t) acc[ch] * (256 - opacity[l]) + (uint32_t) r * opacity[l]) >> 8;
+      }
+    }
+
+    for (uint8_t ch = 0; ch < 3; ch++)
+      out[i].raw[ch] = (out[i].raw[ch] * keep + (acc[ch] >> 8) * incoming + 0x80) >> 8;
+  }
+}
+
+/// @brief Reads one output pixel through a view.
+/// @param v       The view to read through.
+/// @param j       The output pixel.
+/// @param out_len The length of the output the view covers.
+CRGB view_pixel(const Pixel_View * v, int j, int out_len){
+  const CRGB * src;
+  int stride;
+  view_span(v, j, out_len, &src, &stride);
+  return *src;
+}
+
+/// @brief Scales a pattern segment and smooths it into the output.
+/// @param out        The smoothed output, holding the previous frame.
+/// @param len        The number of pixels to composite.
+/// @param src        The view of the pattern's LED buffer.
+/// @param brightness The pattern's brightness, 0-255.
+/// @param smoothing  How much of the previous frame to keep, 0-255.
+void composite_segment(CRGB * out, int len, const Pixel_View * src,
+                       uint8_t brightness, uint8_t smoothing){
+
+  if (src->len <= 0) return;
+
+  uint16_t incoming = to_q8(255 - smoothing);
+  uint16_t wa = (to_q8(brightness) * incoming) >> 8;
+
+  for (int j = 0; j < len; ) {
+    const CRGB * a;
+    int sa;
+    int n = min(len - j, view_span(src, j, len, &a, &sa));
+
+    composite_pixels(&out[j], a, sa, 256 - incoming, wa, n);
+    j += n;
+  }
+}
+
+/// @brief Composites a stack of layers and smooths it into the output.
+/// @param out       The smoothed output, holding the previous frame.
+/// @param len       The number of pixels to composite.
+/// @param layers    The layers, from the bottom up.
+/// @param count     The number of layers, up to PATTERN_LIMIT.
+/// @param smoothing How much of the previous frame to keep, 0-255.
+///
+/// Each layer is scaled by its brightness, blended onto the layers
+/// below with its blend mode, then mixed in by its opacity. The
+/// bottom layer is drawn over black.
+void composite_stack(CRGB * out, int len, const Layer * layers,
+                     uint8_t count, uint8_t smoothing){
+
+  if (count > PATTERN_LIMIT) count = PATTERN_LIMIT;
+
+  bool linear = true;
+  for (uint8_t l = 0; l < count; l++) {
+    if (layers[l].view.len <= 0) return;
+    if (l && layers[l].blend_mode != BLEND_NORMAL) linear = false;
+  }
+
+  uint16_t incoming = to_q8(255 - smoothing);
+
+  // A normal stack folds into one weight per layer. Working from
+  // the top down, each layer is covered by the opacity above it.
+  uint16_t weights[PATTERN_LIMIT];
+  uint16_t visible = incoming;
+  for (int l = count - 1; l >= 0; l--) {
+    uint16_t opacity = to_q8(layers[l].opacity);
+    weights[l] = (to_q8(layers[l].brightness) * ((opacity * visible) >> 8)) >> 8;
+    visible = (visible * (256 - opacity)) >> 8;
+  }
+
+  const CRGB * src[PATTERN_LIMIT];
+  int stride[PATTERN_LIMIT];
+
+  for (int j = 0; j < len; ) {
+    int n = len - j;
+    for (uint8_t l = 0; l < count; l++)
+      n = min(n, view_span(&layers[l].view, j, len, &src[l], &stride[l]));
+
+    if (linear)
+      composite_pixels(&out[j], src, stride, weights, count, 256 - incoming, n);
+    else
+      composite_blended(&out[j], src, stride, layers, count, incoming, n);
+
+    j += n;
+  }
+}
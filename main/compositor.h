@@ -0,0 +1,48 @@
+/**@file
+ *
+ * This file contains function headers for compositor.cpp.
+ *
+ * The compositor moves finished pattern buffers into the
+ * smoothed output buffer, applying brightness, layering and
+ * temporal smoothing in a single pass.
+ *
+**/
+
+#ifndef COMPOSITOR_H
+#define COMPOSITOR_H
+
+#include <FastLED.h>
+#include "nanolux_types.h"
+#include "storage.h"
+
+/// @brief How a pattern's buffer maps onto its part of the strip.
+///
+/// Patterns always render forward into the first (len) pixels of
+/// their buffer. Reversing and mirroring are applied as address
+/// mappings while compositing, so the buffer is never copied.
+typedef struct{
+
+  const CRGB * leds;      /// The pattern's forward LED buffer.
+  int len;                /// The number of pixels the pattern rendered.
+  bool reversed = false;  /// Read the buffer back to front.
+  bool mirrored = false;  /// Fold the buffer back across the right side.
+
+} Pixel_View;
+
+/// @brief One layer of a layer stack.
+typedef struct{
+
+  Pixel_View view;             /// The view of the layer's LED buffer.
+  uint8_t brightness = 255;    /// Scales the layer's pixels.
+  uint8_t opacity = 255;       /// How much the layer covers the layers below.
+  uint8_t blend_mode = BLEND_NORMAL; /// How the layer combines with the layers below.
+
+} Layer;
+
+CRGB view_pixel(const Pixel_View * v, int j, int out_len);
+void composite_segment(CRGB * out, int len, const Pixel_View * src,
+                       uint8_t brightness, uint8_t smoothing);
+void composite_stack(CRGB * out, int len, const Layer * layers,
+                     uint8_t count, uint8_t smoothing);
+
+#endif
@@ -11,6 +11,7 @@
 #include "arduinoFFT.h"
 #include "nanolux_types.h"
 #include "nanolux_util.h"
+#include "core_analysis.h"
 #include <cmath>
 
 /// Audio sampling period
@@ -45,6 +46,10 @@ ArduinoFFT<double> FFT = ArduinoFFT<double>(vReal, vImag, SAMPLES, SAMPLING_FREQ
 /// with the largest delta between iterations.
 extern double maxDelt;
 
+/// Bands currently listened to by loaded patterns. Patterns
+/// with the same band share one entry.
+Band_Focus band_foci[PATTERN_LIMIT];
+
 /// @brief Samples incoming audio and stores the signal in vReal.
 ///
 /// Reads from ANALOG_PIN for the calculated sampling period. Once a timestep
@@ -106,3 +111,121 @@ void update_peak(){
   FFT.complexToMagnitude(vReal, vImag, SAMPLES);
   peak = FFT.majorPeak(vReal, SAMPLES, SAMPLING_FREQUENCY);
 }
+
+/// @brief Checks if a pattern listens to a narrower band than the
+/// whole spectrum.
+/// @param p The pattern to check.
+static bool has_band_focus(const Pattern_Data * p){
+  return p->band_high != 0 && p->band_high >= p->band_low;
+}
+
+/// @brief Finds the band focus entry for a pattern's band.
+/// @param p The pattern to look up.
+/// @returns The matching entry, or nullptr if there is none.
+static Band_Focus * find_band_focus(const Pattern_Data * p){
+  for (int i = 0; i < PATTERN_LIMIT; i++) {
+    if (band_foci[i].high != 0 &&
+        band_foci[i].low == p->band_low &&
+        band_foci[i].high == p->band_high)
+      return &band_foci[i];
+  }
+  return nullptr;
+}
+
+/// @brief Rebuilds the bin mask of a band focus entry.
+/// @param f    The entry to rebuild.
+/// @param low  The lowest bin in the band.
+/// @param high The highest bin in the band.
+///
+/// The lowest bins are always left out, as they hold the DC
+/// offset of the microphone rather than audio.
+static void build_band_mask(Band_Focus * f, uint8_t low, uint8_t high){
+  f->low = low;
+  f->high = high;
+  memset(f->mask, 0, sizeof(f->mask));
+
+  int first = max(3, (int) low);
+  int last = min(SAMPLES / 2 - 1, (int) high);
+  for (int i = first; i <= last; i++) {
+    f->mask[i / 32] |= 1UL << (i % 32);
+  }
+}
+
+/// @brief Calculates the volume and peak of every band listened to
+/// by the loaded patterns.
+/// @param patterns The loaded patterns.
+/// @param count    The number of loaded patterns.
+///
+/// Masks are only rebuilt when a band that no entry covers shows up,
+/// so the per-frame cost is one pass over each distinct band.
+void update_band_focus(const Pattern_Data * patterns, uint8_t count){
+
+  for (int i = 0; i < PATTERN_LIMIT; i++)
+    band_foci[i].used = false;
+
+  // Keep entries whose band is still listened to.
+  for (int p = 0; p < count; p++) {
+    if (!has_band_focus(&patterns[p])) continue;
+    Band_Focus * f = find_band_focus(&patterns[p]);
+    if (f) f->used = true;
+  }
+
+  // Build masks for new bands in entries that went unused.
+  for (int p = 0; p < count; p++) {
+    if (!has_band_focus(&patterns[p]) || find_band_focus(&patterns[p])) continue;
+    for (int i = 0; i < PATTERN_LIMIT; i++) {
+      if (!band_foci[i].used) {
+        build_band_mask(&band_foci[i], patterns[p].band_low, patterns[p].band_high);
+        band_foci[i].used = true;
+        break;
+      }
+    }
+  }
+
+  // Analyze each distinct band once.
+  for (int i = 0; i < PATTERN_LIMIT; i++) {
+    Band_Focus * f = &band_foci[i];
+    if (!f->used) continue;
+
+    double sum = 0;
+    double loudest = 0;
+    int loudest_bin = 0;
+    int bins = 0;
+
+    for (int w = 0; w < BAND_MASK_WORDS; w++) {
+      uint32_t bits = f->mask[w];
+      while (bits) {
+        int bin = w * 32 + __builtin_ctz(bits);
+        bits &= bits - 1;
+
+        sum += vReal[bin];
+        bins++;
+        if (vReal[bin] > loudest) {
+          loudest = vReal[bin];
+          loudest_bin = bin;
+        }
+      }
+    }
+
+    f->volume = (bins) ? sum / bins : 0;
+    f->peak = (double) loudest_bin * SAMPLING_FREQUENCY / SAMPLES;
+  }
+}
+
+/// @brief Gets the volume and peak a pattern should render from.
+/// @param p            The pattern being rendered.
+/// @param band_volume  Output for the volume inside the pattern's band.
+/// @param band_peak    Output for the peak frequency inside the pattern's band.
+///
+/// Patterns without a band focus get the full-spectrum values.
+void get_band_audio(const Pattern_Data * p, double * band_volume, double * band_peak){
+  Band_Focus * f = (has_band_focus(p)) ? find_band_focus(p) : nullptr;
+
+  if (f && f->used) {
+    *band_volume = f->volume;
+    *band_peak = f->peak;
+  } else {
+    *band_volume = volume;
+    *band_peak = peak;
+  }
+}
@@ -1,10 +1,34 @@
 #ifndef CORE_ANALYSIS_H
 #define CORE_ANALYSIS_H
 
+#include "nanolux_types.h"
+#include "storage.h"
+
+/// The number of 32-bit words needed to mask every bin below Nyquist.
+#define BAND_MASK_WORDS ((SAMPLES / 2 + 31) / 32)
+
+/// @brief A precomputed set of FFT bins that one or more patterns
+/// listen to, along with the features calculated from those bins.
+///
+/// Patterns that share a band share a single Band_Focus, so each
+/// distinct band is only analyzed once per frame.
+typedef struct{
+
+  uint8_t low = 0;  /// The lowest bin in the band.
+  uint8_t high = 0; /// The highest bin in the band.
+  uint32_t mask[BAND_MASK_WORDS] = {0}; /// One bit per bin inside the band.
+  bool used = false; /// If a loaded pattern listened to this band this frame.
+  double volume = 0; /// The average magnitude inside the band.
+  double peak = 0;   /// The loudest frequency inside the band, in Hz.
+
+} Band_Focus;
+
 void sample_audio();
 void noise_gate(int threshhold);
 void update_volume();
 void update_max_delta();
 void update_peak();
+void update_band_focus(const Pattern_Data * patterns, uint8_t count);
+void get_band_audio(const Pattern_Data * p, double * band_volume, double * band_peak);
 
 #endif
\ No newline at end of file
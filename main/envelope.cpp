@@ -0,0 +1,157 @@
+/** @file
+  *
+  * This file's functions smooth audio features over time.
+  *
+  * The analysis stage owns one follower per smoothed feature,
+  * so patterns can read a smoothed value without keeping their
+  * own history arrays.
+  *
+*/
+
+#include <string.h>
+#include "envelope.h"
+
+/// @brief Converts a feature value into Q8 fixed point.
+/// @param x The value to convert.
+/// @returns The value in Q8, saturated to the int32_t range.
+static int32_t to_fixed(double x){
+  double scaled = x * (1 << ENVELOPE_FRAC_BITS);
+  if(scaled > INT32_MAX) return INT32_MAX;
+  if(scaled < INT32_MIN) return INT32_MIN;
+  return (int32_t) scaled;
+}
+
+/// @brief Converts a Q8 fixed point value back into a feature value.
+/// @param x The Q8 value to convert.
+/// @returns The value as a double.
+static double from_fixed(int32_t x){
+  return (double) x / (1 << ENVELOPE_FRAC_BITS);
+}
+
+/************************************************
+ *
+ * ENVELOPE FOLLOWER
+ *
+*************************************************/
+
+/// @brief Configures an envelope follower and clears its value.
+/// @param env      The follower to configure.
+/// @param attack   Q16 rate used when the input rises.
+/// @param release  Q16 rate used when the input falls.
+/// @param hold     Updates a new peak is held before releasing.
+void envelope_init(Envelope * env, uint16_t attack, uint16_t release, uint16_t hold){
+  env->attack = attack;
+  env->release = release;
+  env->hold = hold;
+  envelope_reset(env);
+}
+
+/// @brief Clears the value of an envelope follower.
+/// @param env The follower to clear.
+void envelope_reset(Envelope * env){
+  env->value = 0;
+  env->hold_count = 0;
+}
+
+/// @brief Moves the follower towards a new input.
+/// @param env    The follower to update.
+/// @param input  The newest value of the followed feature.
+/// @returns The updated value of the follower.
+double envelope_update(Envelope * env, double input){
+
+  int32_t target = to_fixed(input);
+  int32_t delta = target - env->value;
+  uint16_t rate;
+
+  if(delta >= 0){
+    // A new peak restarts the hold timer.
+    env->hold_count = env->hold;
+    rate = env->attack;
+  }else if(env->hold_count > 0){
+    // Hold the current peak.
+    env->hold_count--;
+    return from_fixed(env->value);
+  }else{
+    rate = env->release;
+  }
+
+  // A rate of 65535 is treated as a full step, so an instant
+  // follower lands exactly on the input.
+  if(rate == UINT16_MAX){
+    env->value = target;
+  }else{
+    env->value += (int32_t) (((int64_t) delta * rate) >> 16);
+  }
+
+  return from_fixed(env->value);
+}
+
+/// @brief Returns the current value of an envelope follower.
+/// @param env The follower to read.
+double envelope_value(const Envelope * env){
+  return from_fixed(env->value);
+}
+
+/************************************************
+ *
+ * RUNNING AVERAGE
+ *
+*************************************************/
+
+/// @brief Sets the window size of a running average and clears it.
+/// @param avg  The running average to configure.
+/// @param size The number of samples to average, up to RUNNING_AVERAGE_MAX.
+void running_average_init(Running_Average * avg, uint8_t size){
+  if(size > RUNNING_AVERAGE_MAX) size = RUNNING_AVERAGE_MAX;
+  if(size == 0) size = 1;
+
+  memset(avg->samples, 0, sizeof(avg->samples));
+  avg->sum = 0;
+  avg->size = size;
+  avg->pos = 0;
+}
+
+/// @brief Overwrites the oldest sample and advances the window.
+/// @param avg    The running average to update.
+/// @param sample The sample to add.
+/// @returns The mean of the window after the push.
+double running_average_push(Running_Average * avg, double sample){
+  running_average_set(avg, avg->pos, sample);
+  avg->pos = (avg->pos + 1 == avg->size) ? 0 : avg->pos + 1;
+  return running_average_mean(avg);
+}
+
+/// @brief Overwrites the oldest sample with a raw value and advances the window.
+/// @param avg    The running average to update.
+/// @param sample The sample to add, stored as is rather than in Q8.
+///
+/// For integer features, such as FFT bins, that are averaged every
+/// frame. Nothing is converted, and the caller reads the mean back
+/// from the running sum.
+void running_average_push_raw(Running_Average * avg, int32_t sample){
+  avg->sum += sample - avg->samples[avg->pos];
+  avg->samples[avg->pos] = sample;
+  avg->pos = (avg->pos + 1 == avg->size) ? 0 : avg->pos + 1;
+}
+
+/// @brief Replaces a single sample in the window.
+/// @param avg    The running average to update.
+/// @param index  The window slot to overwrite. Ignored if out of range.
+/// @param sample The new sample value.
+///
+/// The running sum is adjusted by the difference between the old
+/// and new sample, so this never iterates over the window.
+void running_average_set(Running_Average * avg, uint8_t index, double sample){
+  if(index >= avg->size) return;
+
+  int32_t fixed = to_fixed(sample);
+  avg->sum += fixed - avg->samples[index];
+  avg->samples[index] = fixed;
+}
+
+/// @brief Returns the mean of every sample in the window.
+/// @param avg The running average to read.
+double running_average_mean(const Running_Average * avg){
+  return from_fixed(avg->sum / avg->size);
+}
+
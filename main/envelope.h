@@ -0,0 +1,69 @@
+/**@file
+ *
+ * This file contains the envelope follower and running average
+ * structures used to smooth audio features over time.
+ *
+ * Both structures store their values in fixed point and update
+ * in constant time, no matter how long the smoothing window is.
+ *
+**/
+
+#ifndef ENVELOPE_H
+#define ENVELOPE_H
+
+#include <stdint.h>
+
+/// The number of fractional bits used by smoothed values.
+#define ENVELOPE_FRAC_BITS 8
+
+/// The largest window a running average can hold.
+#define RUNNING_AVERAGE_MAX 20
+
+/// The window a running average uses until it is resized.
+#define RUNNING_AVERAGE_DEFAULT 20
+
+/// @brief Follows the envelope of a feature with separate
+/// attack and release rates.
+///
+/// Attack and release are Q16 fractions of the gap between the
+/// current value and the input that is closed every update.
+/// 65535 follows the input instantly, 0 never moves.
+///
+/// When hold is nonzero, the follower acts as a peak-hold meter.
+/// After a new peak, the value is held for that many updates
+/// before it is allowed to decay at the release rate.
+typedef struct{
+
+  int32_t value = 0;        /// The current value, in Q8.
+  uint16_t attack = 65535;  /// Rate used when the input is above the value.
+  uint16_t release = 65535; /// Rate used when the input is below the value.
+  uint16_t hold = 0;        /// Updates to hold a peak before releasing.
+  uint16_t hold_count = 0;  /// Updates left before the current peak releases.
+
+} Envelope;
+
+/// @brief Averages the last (size) samples of a feature.
+///
+/// Keeps a running sum next to the sample window, so reading
+/// the mean never iterates over the window.
+typedef struct{
+
+  int32_t samples[RUNNING_AVERAGE_MAX] = {0}; /// Sample window, in Q8.
+  int32_t sum = 0;     /// Sum of every sample in the window.
+  uint8_t size = RUNNING_AVERAGE_DEFAULT; /// The number of samples averaged.
+  uint8_t pos = 0;     /// The slot the next pushed sample overwrites.
+
+} Running_Average;
+
+void envelope_init(Envelope * env, uint16_t attack, uint16_t release, uint16_t hold);
+double envelope_update(Envelope * env, double input);
+double envelope_value(const Envelope * env);
+void envelope_reset(Envelope * env);
+
+void running_average_init(Running_Average * avg, uint8_t size);
+double running_average_push(Running_Average * avg, double sample);
+void running_average_push_raw(Running_Average * avg, int32_t sample);
+void running_average_set(Running_Average * avg, uint8_t index, double sample);
+double running_average_mean(const Running_Average * avg);
+
+#endif
@@ -12,6 +12,7 @@
 #include "patterns.h"
 #include "nanolux_types.h"
 #include "nanolux_util.h"
+#include "filterbank.h"
 #include <cmath>
 
 /// Global variable used to access the current volume.
@@ -24,17 +25,8 @@ extern double peak;
 /// Processing is done in place.
 extern double vReal[SAMPLES];
 
-/// Used for smoothing (old) formant processing.
-extern int F0arr[20];
-
-/// Used for smoothing (old) formant processing.
-extern int F1arr[20];
-
-/// Used for smoothing (old) formant processing.
-extern int F2arr[20];
-
-/// Used for smoothing (old) formant processing.
-extern int formant_pose;
+/// Running averages used to smooth each detected formant.
+extern Running_Average formant_history[3];
 
 /// Global formant array, used for accessing.
 extern double formants[3];
@@ -43,87 +35,69 @@ extern double formants[3];
 /// based on raw frequencies
 extern double fbs[5]; 
 
+/// Global vowel detected in the current frame.
+extern VowelSounds current_vowel;
+
+/// Global log-spaced filterbank, one value per band.
+extern double log_bands[FILTERBANK_MAX_BANDS];
+
 
 /// @brief Calculates the frequency bands with the highest density.
-/// @returns An array of the highest density formants.
+///
+/// Places the smoothed formants, in Hz, in the "formants" array.
+///
+/// A 20-bin window is slid across the spectrum once, so each bin
+/// enters and leaves the loud-bin count exactly once. Only bins
+/// below the Nyquist frequency are scanned, as the upper half of
+/// vReal mirrors the lower half.
 ///
 /// This is intended to be used for functions like vowel detection, and
 /// is used in a couple patterns.
 /// For any nontrivial applications, do not use this.
-double* density_formant(){
+void density_formant(){
   // Define the Formants to fill with values
-  int F0 = 0;
-  int F1 = 0;
-  int F2 = 0;
-  int count = 0; // Keep a count of the biggest densities
+  int bins[3] = {0, 0, 0};
+  int found = 0;
   int left = 10; // Left bound of frequency to avoid noise
   int right = 10; // Right Bound of frequency to avoid
-  int len = (sizeof(vReal)/sizeof(vReal[0])) - right; // Grab the length of the desired range
+  int len = SAMPLES / 2 - right; // Grab the length of the desired range
+
+  // The window currently counted is [lo, hi).
+  int lo = 0;
+  int hi = 0;
+  int count = 0;
 
   // Iterate through the frequencies array
-  for (int i = left + 3; i < len; i += (int) (1.0*right)) {
-    count = 0;
-    // Iterate through each chunk of the frequencies array
-    for (int j = i - left; j < i + right; j++) {
-      if (vReal[j] > 200) { // If the amount of frequencies is loud enough, increase the count
-        count += 1;
-      }
-    }
+  for (int i = left + 3; i < len && found < 3; i += right) {
 
+    // Slide the window to [i - left, i + right), counting the bins
+    // loud enough to be part of a formant.
+    while (hi < i + right) {
+      if (vReal[hi++] > 200) count++;
+    }
+    while (lo < i - left) {
+      if (vReal[lo++] > 200) count--;
+    }
 
     if (count > 12) { // 10 (better when the bound for vReal[j] > is 700) or 12 works well
-      if (F0 == 0) { // If F0 is empty...
-        F0 = vReal[i]; // Store the Formant
-        F0arr[formant_pose] = F0; // Add to the formants array to be smoothed later
-      }
-      else if (F0 != 0 && F1 == 0) { // If F1 is empty...
-        F1 = vReal[i]; // Store the Formant
-        F1arr[formant_pose] = F1; // Add to the formants array to be smoothed later
-      }
-      else { // If F2 is empty...
-        F2 = vReal[i]; // Store the Formant
-        F2arr[formant_pose] = F2; // Add to the formants array to be smoothed later
-      }
+      bins[found++] = i; // Store the formant
       // If adding more catches for formants, follow the schema above
       //    Also, it is advised to tweak the hyper-parameters of checking vReal>200, smoothing array size, and count
       i += right; // Jump past the current band to avoid grabbing the same sample band
     }
   }
 
-  // If the position of the sample being stored for smoothing is too big, reset its value
-  if (formant_pose == 21)
-    formant_pose = 0;
-
-
-  // Increment Formant position for smoothing array
-  formant_pose += 1;
-  // Redefine the formants to be able to get the smoothed version
-  F0 = 0; 
-  F1 = 0;
-  F2 = 0;
-
-  // Iterate through the smoothing arrays and store the sums of formants
-  for (int z = 0; z < 22; z++) {
-    F0 += F0arr[z];
-    F1 += F1arr[z];
-    F2 += F2arr[z];
+  // Smooth each formant that was found this frame. The history
+  // holds bins, so nothing is converted until the mean is read.
+  for (int f = 0; f < found; f++) {
+    running_average_push_raw(&formant_history[f], bins[f]);
   }
 
-  // Divide by the length of the smoothing array to get the average formants
-  F0 /= 22;
-  F1 /= 22;
-  F2 /= 22;
-
-  // Create an array to store the formants
-  double* temp_formants = new double[3];
-
-  // Store the formants
-  temp_formants[0] = F0;
-  temp_formants[1] = F1;
-  temp_formants[2] = F2;
-  
-  // Output the array containing each formant
-  return temp_formants;
+  // Store the smoothed formants, converting bins to frequencies.
+  for (int f = 0; f < 3; f++) {
+    const Running_Average * avg = &formant_history[f];
+    formants[f] = (double) avg->sum * SAMPLING_FREQUENCY / (SAMPLES * avg->size);
+  }
 }
 
 /// @brief Outputs the average volume of 5 buckets given a sample length.
@@ -204,7 +178,7 @@ void temp_to_array(double * temp, double * arr, int len){
 /// @brief Moves data from the formant calculation
 /// function to the global array.
 void update_formants() {
-  temp_to_array(density_formant(), formants, 3);
+  density_formant();
 }
 
 /// @brief Moves data from the 5-band-split calculation
@@ -214,6 +188,9 @@ void update_five_band_split(int len) {
 }
 
 /// @brief Detects vowels based off of formants.
+///
+/// Peaks are compared against a fraction of the loudest bin, so
+/// vReal is left untouched for the patterns that read it.
 VowelSounds vowel_detection() {
 
   //find the max value
@@ -224,16 +201,16 @@ VowelSounds vowel_detection() {
     }
   }
 
-  //normalize vReal. leave the first and last few idx of vReal out due to garbage data. noise_threshold filters out junk data
+  //leave the first and last few idx of vReal out due to garbage data. noise_threshold filters out junk data
   int noise_threshold = 450;
-  for (int i = 3; i < SAMPLES - 2; i++) {
-    if (maxVal < noise_threshold) {
-      vReal[i] = 0;
-    } else vReal[i] /= maxVal;
+  if (maxVal < noise_threshold) {
+    return noVowel;
   }
 
   // primary peaks are in the first set of paranthesis. second set (if present) are the sub-peaks 
-  double peak_threshold = .9;
+  // Thresholds are scaled by maxVal instead of normalizing vReal.
+  double peak_threshold = .9 * maxVal;
+  double sub_threshold = .8 * maxVal;
   if((vReal[17] > peak_threshold && vReal[111] > peak_threshold)){
     //Serial.println("found an 'i' like 'find'");
     return iVowel;
@@ -243,7 +220,7 @@ VowelSounds vowel_detection() {
   }else if((vReal[12] > peak_threshold && vReal[116] > peak_threshold)){
     //Serial.println("found an oh like 'no'");
     return oVowel;
-  }else if((vReal[6] > peak_threshold && vReal[126] > peak_threshold) && (vReal[5] > peak_threshold-.1 && vReal[123] > peak_threshold-.1)){
+  }else if((vReal[6] > peak_threshold && vReal[126] > peak_threshold) && (vReal[5] > sub_threshold && vReal[123] > sub_threshold)){
     //Serial.println("found an ooooo like 'boot'");
     return oVowel;
   }else if((vReal[9] > peak_threshold && vReal[119] > peak_threshold)){
@@ -259,4 +236,17 @@ VowelSounds vowel_detection() {
   return noVowel;
 }
 
+/// @brief Moves the detected vowel to the global variable.
+///
+/// Runs once per frame, so patterns rendering in parallel
+/// can all read the same result.
+void update_vowel() {
+  current_vowel = vowel_detection();
+}
 
+/// @brief Applies the log-spaced filterbank to the current spectrum.
+///
+/// Places one value per band in the "log_bands" array.
+void update_log_bands() {
+  filterbank_apply(vReal, log_bands);
+}
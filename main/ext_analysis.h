@@ -1,11 +1,13 @@
 #ifndef EXT_ANALYSIS_H
 #define EXT_ANALYSIS_H
 
-double* density_formant();
+void density_formant();
 double* band_split_bounce(int len);
 void temp_to_array(double * temp, double * arr, int len);
 void update_formants();
 void update_five_band_split(int len);
 VowelSounds vowel_detection();
+void update_vowel();
+void update_log_bands();
 
 #endif
\ No newline at end of file
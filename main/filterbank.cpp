@@ -0,0 +1,126 @@
+/** @file
+  *
+  * This file's functions compute a log-spaced filterbank from
+  * the FFT magnitudes.
+  *
+  * Musical pitch is logarithmic, so each band covers the same
+  * musical interval instead of the same number of FFT bins. The
+  * kernel is built once and applied every frame.
+  *
+*/
+
+#include <math.h>
+#include "nanolux_types.h"
+#include "filterbank.h"
+
+/// The kernel used by filterbank_apply().
+Filterbank_Kernel filterbank_kernel;
+
+/// @brief Builds the sparse kernel for a number of bands.
+/// @param bands              The number of bands, up to FILTERBANK_MAX_BANDS.
+/// @param fft_size           The number of samples the FFT runs on.
+/// @param sampling_frequency The audio sampling frequency, in Hz.
+///
+/// Band centers are spaced evenly in log frequency between
+/// MIN_FREQUENCY and MAX_FREQUENCY (or Nyquist, if lower), and
+/// never below FILTERBANK_FIRST_BIN. Each band is a triangle that
+/// peaks at its center and reaches zero at the centers of its
+/// neighbors. Weights are normalized so a band outputs the
+/// weighted average magnitude of its bins.
+///
+/// At small FFT sizes the lowest bands are narrower than a bin.
+/// Their centers are pushed up one bin at a time, so every band
+/// peaks on a bin of its own. If there are fewer bins than bands,
+/// the band count is lowered to fit.
+void filterbank_init(uint8_t bands, uint16_t fft_size, double sampling_frequency){
+
+  Filterbank_Kernel * k = &filterbank_kernel;
+
+  int nyquist_bin = fft_size / 2;
+  double bin_width = sampling_frequency / fft_size;
+  double high = fmin(MAX_FREQUENCY, sampling_frequency / 2) / bin_width;
+
+  // The outer edges get no weight, so the lowest edge sits one bin
+  // below the first bin read, and the highest may sit at Nyquist.
+  int lowest_edge = FILTERBANK_FIRST_BIN - 1;
+  double low = fmax(MIN_FREQUENCY / bin_width, lowest_edge);
+
+  // Both outer edges and every center need a bin of their own.
+  int max_bands = nyquist_bin - FILTERBANK_FIRST_BIN;
+  if(bands > FILTERBANK_MAX_BANDS) bands = FILTERBANK_MAX_BANDS;
+  if(bands > max_bands) bands = (max_bands > 0) ? max_bands : 0;
+  k->bands = bands;
+
+  // Edge i is the lower edge of band i, the center of band i - 1
+  // and the upper edge of band i - 2.
+  int edges[FILTERBANK_MAX_BANDS + 2];
+  double ratio = log(high / low) / (bands + 1);
+
+  for(int i = 0; i < bands + 2; i++){
+    int bin = (int) round(low * exp(ratio * i));
+    if(i && bin <= edges[i - 1]) bin = edges[i - 1] + 1;
+    edges[i] = bin;
+  }
+
+  // Pushing the low edges up may have run the top ones past Nyquist.
+  for(int i = bands + 1; i >= 0; i--){
+    int ceiling = (i == bands + 1) ? nyquist_bin : edges[i + 1] - 1;
+    if(edges[i] > ceiling) edges[i] = ceiling;
+  }
+
+  int used = 0;
+
+  for(int b = 0; b < bands; b++){
+
+    int lower = edges[b];
+    int center = edges[b + 1];
+    int upper = edges[b + 2];
+
+    k->first_bin[b] = lower + 1;
+    k->bin_count[b] = 0;
+    float sum = 0;
+
+    for(int bin = lower + 1; bin < upper && used + k->bin_count[b] < FILTERBANK_MAX_WEIGHTS; bin++){
+      float w = (bin <= center)
+        ? (float) (bin - lower) / (center - lower)
+        : (float) (upper - bin) / (upper - center);
+
+      k->weights[used + k->bin_count[b]] = w;
+      k->bin_count[b]++;
+      sum += w;
+    }
+
+    for(int i = 0; i < k->bin_count[b]; i++)
+      k->weights[used + i] /= sum;
+
+    used += k->bin_count[b];
+  }
+}
+
+/// @brief Applies the filterbank kernel to a magnitude spectrum.
+/// @param magnitudes The FFT magnitudes, such as vReal after the FFT.
+/// @param out        The array to store every band's value in.
+///
+/// The cost is one multiply-add per nonzero weight, which is at
+/// most a couple per FFT bin.
+void filterbank_apply(const double * magnitudes, double * out){
+
+  const Filterbank_Kernel * k = &filterbank_kernel;
+  const float * w = k->weights;
+
+  for(int b = 0; b < k->bands; b++){
+    const double * m = &magnitudes[k->first_bin[b]];
+    float acc = 0;
+
+    for(int i = 0; i < k->bin_count[b]; i++)
+      acc += (float) m[i] * w[i];
+
+    out[b] = acc;
+    w += k->bin_count[b];
+  }
+}
+
+/// @brief Returns the number of bands the filterbank produces.
+uint8_t filterbank_band_count(){
+  return filterbank_kernel.bands;
+}
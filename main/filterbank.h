@@ -0,0 +1,45 @@
+/**@file
+ *
+ * This file contains function headers for filterbank.cpp
+ * along with the sparse kernel used by the filterbank.
+ *
+**/
+
+#ifndef FILTERBANK_H
+#define FILTERBANK_H
+
+#include <stdint.h>
+
+/// The largest number of bands the filterbank can produce.
+#define FILTERBANK_MAX_BANDS 32
+
+/// The lowest FFT bin the filterbank reads. Lower bins hold the
+/// microphone's DC offset, which the rest of the analysis leaves
+/// out too.
+#define FILTERBANK_FIRST_BIN 3
+
+/// The largest number of nonzero kernel weights. Neighboring
+/// bands overlap, so every FFT bin up to 512 samples feeds at most
+/// two bands.
+#define FILTERBANK_MAX_WEIGHTS 512
+
+/// @brief A precomputed sparse matrix that maps FFT bins to
+/// log-spaced bands.
+///
+/// Each band reads a contiguous run of bins. The runs are stored
+/// back to back in one weight array, so applying the kernel is a
+/// single pass over the nonzero weights.
+typedef struct{
+
+  uint8_t bands = 0; /// The number of bands the kernel produces.
+  uint16_t first_bin[FILTERBANK_MAX_BANDS]; /// The first bin each band reads.
+  uint16_t bin_count[FILTERBANK_MAX_BANDS]; /// The number of bins each band reads.
+  float weights[FILTERBANK_MAX_WEIGHTS]; /// Every band's weights, back to back.
+
+} Filterbank_Kernel;
+
+void filterbank_init(uint8_t bands, uint16_t fft_size, double sampling_frequency);
+void filterbank_apply(const double * magnitudes, double * out);
+uint8_t filterbank_band_count();
+
+#endif
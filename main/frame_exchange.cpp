@@ -0,0 +1,134 @@
+/** @file
+  *
+  * This file's functions hand frames from the loop to the output
+  * task, and blend the task's frames towards the newest one.
+  *
+  * Nothing here touches FreeRTOS or the LED hardware, so the
+  * hand-over also builds and runs on a host.
+  *
+*/
+
+#include <string.h>
+#include "frame_exchange.h"
+#include "output.h"
+
+/// @brief Lays out the frame buffers of an exchange.
+/// @param fx       The exchange to set up.
+/// @param frames   FRAME_EXCHANGE_BUFFERS * capacity zeroed LEDs, or nullptr.
+/// @param capacity The number of LEDs every frame holds.
+///
+/// Drops any pending frame and forgets the frame on the strip.
+void frame_exchange_init(Frame_Exchange * fx, CRGB * frames, uint16_t capacity){
+
+  if (!frames) capacity = 0;
+
+  *fx = Frame_Exchange();
+  fx->back = frames;
+  fx->pending = frames + capacity;
+  fx->from = frames + capacity * 2;
+  fx->to = frames + capacity * 3;
+  fx->sent = frames + capacity * 4;
+}
+
+/// @brief Publishes the back frame as the pending frame.
+/// @param fx  The exchange.
+/// @param len The number of LEDs in the back frame.
+/// @param now The current time, in ms.
+///
+/// Call with the pending frame guarded. Afterwards, the back
+/// frame is the old pending frame. A pending frame the task has
+/// not taken yet is replaced, as only the newest frame is shown.
+void frame_publish(Frame_Exchange * fx, uint16_t len, uint32_t now){
+  CRGB * next = fx->pending;
+  fx->pending = fx->back;
+  fx->back = next;
+  fx->pending_len = len;
+  fx->pending_time = now;
+  fx->pending_new = true;
+}
+
+/// @brief Takes the pending frame as the task's new target.
+/// @param fx      The exchange.
+/// @param len     Set to the number of LEDs in the new target.
+/// @param arrival Set to the time the new target was published.
+/// @returns False if there was no new pending frame.
+///
+/// Call with the pending frame guarded. Each published frame is
+/// taken at most once.
+bool frame_take(Frame_Exchange * fx, uint16_t * len, uint32_t * arrival){
+  if (!fx->pending_new) return false;
+
+  CRGB * next = fx->to;
+  fx->to = fx->pending;
+  fx->pending = next;
+  *len = fx->pending_len;
+  *arrival = fx->pending_time;
+  fx->pending_new = false;
+  return true;
+}
+
+/// @brief Blends the sent frame one step towards the target.
+/// @param fx      The exchange.
+/// @param taken   If frame_take() just took a new target.
+/// @param len     The number of LEDs in the new target, if taken.
+/// @param arrival The time the new target was published, if taken.
+/// @param now     The current time, in ms.
+/// @returns True if the sent frame should be sent to the strip.
+///
+/// A new target restarts blending from the frame currently on the
+/// strip, so a frame arriving early never causes a jump. Frames
+/// that did not change are not sent, unless OUTPUT_REFRESH_MS
+/// passed since the last one was.
+bool frame_advance(Frame_Exchange * fx, bool taken, uint16_t len, uint32_t arrival, uint32_t now){
+
+  bool resized = false;
+
+  if (taken) {
+    // Snap to the new frame if the strip length changed.
+    resized = (len != fx->sent_len);
+    if (resized) {
+      memcpy(fx->sent, fx->to, sizeof(CRGB) * len);
+      fx->sent_len = len;
+    }
+
+    memcpy(fx->from, fx->sent, sizeof(CRGB) * fx->sent_len);
+
+    // The next frame should arrive as long after this one as this
+    // one did after the last.
+    fx->interval = constrain(arrival - fx->start, (uint32_t) 1, (uint32_t) OUTPUT_MAX_INTERVAL);
+    fx->start = arrival;
+  }
+
+  uint32_t fraction = min((uint32_t) ((uint64_t) (now - fx->start) * 65536 / fx->interval), (uint32_t) 65536);
+  bool changed = frame_blend(fx->from, fx->to, fx->sent, fx->sent_len, fraction) || resized;
+
+  if (!changed && now - fx->last_show < OUTPUT_REFRESH_MS) return false;
+
+  fx->last_show = now;
+  return true;
+}
+
+/// @brief Blends two frames into a third.
+/// @param a        The frame to blend from.
+/// @param b        The frame to blend towards.
+/// @param out      The frame to write the blend to.
+/// @param len      The number of LEDs to blend.
+/// @param fraction How far to go from (a) to (b), in 1/65536.
+/// @returns True if any LED in (out) changed.
+bool frame_blend(const CRGB * a, const CRGB * b, CRGB * out, uint16_t len, uint32_t fraction){
+
+  bool changed = false;
+  const uint8_t * pa = a->raw;
+  const uint8_t * pb = b->raw;
+  uint8_t * po = out->raw;
+
+  for (int i = 0; i < len * 3; i++) {
+    int32_t delta = pb[i] - pa[i];
+    uint8_t v = pa[i] + ((delta * (int32_t) fraction + 32768) >> 16);
+
+    changed |= (v != po[i]);
+    po[i] = v;
+  }
+
+  return changed;
+}
@@ -0,0 +1,50 @@
+/**@file
+ *
+ * This file contains function headers for frame_exchange.cpp
+ * along with the frame buffers the loop and output task share.
+ *
+ * The loop fills the back frame and publishes it as pending. The
+ * output task takes the pending frame as its new target and
+ * blends towards it. Frames only ever change hands by swapping
+ * pointers, so neither side waits on the other.
+ *
+ * None of these functions lock anything. The caller guards the
+ * pending frame, as marked below.
+ *
+**/
+
+#ifndef FRAME_EXCHANGE_H
+#define FRAME_EXCHANGE_H
+
+#include <FastLED.h>
+
+/// @brief The frame buffers handed between the loop and the output task.
+typedef struct{
+
+  CRGB * back = nullptr;    /// The frame the loop fills next. Owned by the loop.
+  CRGB * pending = nullptr; /// The newest frame from the loop. Guarded.
+  CRGB * from = nullptr;    /// The frame the task blends from. Owned by the task.
+  CRGB * to = nullptr;      /// The frame the task blends towards. Owned by the task.
+  CRGB * sent = nullptr;    /// The frame last sent to the strip. Owned by the task.
+
+  uint16_t pending_len = 0;   /// The number of LEDs in the pending frame. Guarded.
+  uint32_t pending_time = 0;  /// The time the pending frame was published, in ms. Guarded.
+  bool pending_new = false;   /// If the pending frame was not taken yet. Guarded.
+
+  uint16_t sent_len = 0;   /// The number of LEDs in the sent frame. Owned by the task.
+  uint32_t start = 0;      /// The time blending towards the target started, in ms.
+  uint32_t interval = 1;   /// The time blending towards the target takes, in ms.
+  uint32_t last_show = 0;  /// The time a frame was last sent, in ms.
+
+} Frame_Exchange;
+
+/// The number of frames a Frame_Exchange needs per LED.
+#define FRAME_EXCHANGE_BUFFERS 5
+
+void frame_exchange_init(Frame_Exchange * fx, CRGB * frames, uint16_t capacity);
+void frame_publish(Frame_Exchange * fx, uint16_t len, uint32_t now);
+bool frame_take(Frame_Exchange * fx, uint16_t * len, uint32_t * arrival);
+bool frame_advance(Frame_Exchange * fx, bool taken, uint16_t len, uint32_t arrival, uint32_t now);
+bool frame_blend(const CRGB * a, const CRGB * b, CRGB * out, uint16_t len, uint32_t fraction);
+
+#endif
@@ -15,18 +15,17 @@
 #define GLOBALS_H
 
 #include "nanolux_types.h"
+#include "filterbank.h"
 
-int formant_pose = 0;
 double formants[3];  // Master formants array that constantly changes;
 bool noise;          // Master Noisiness versus Periodic flag that is TRUE when noisy, FALSE when periodic;
 bool drums[3];       // Master drums array that stores whether a KICK, SNARE, or CYMBAL is happening in each element of the array;
 double fbs[5];       // Master FIVE BAND SPLIT which stores changing bands based on raw frequencies
 double fss[5];       // Master FIVE SAMPLE SPLIT which stores changing bands based on splitting up the samples
-int advanced_size = 20;
+double log_bands[FILTERBANK_MAX_BANDS]; // Master log-spaced filterbank, one value per band
+VowelSounds current_vowel = noVowel; // Master vowel detected in the current frame
 unsigned int sampling_period_us = round(1000000 / SAMPLING_FREQUENCY);
-int F0arr[20];
-int F1arr[20];
-int F2arr[20];
+Running_Average formant_history[3]; // Smoothing for each formant, in FFT bins
 unsigned long microseconds;
 double vReal[SAMPLES];  // Sampling buffers
 double vImag[SAMPLES];
@@ -39,13 +38,22 @@ unsigned long myTime;     // For nvp
 // Patterns structure.
 //
 // Describes a pattern by name, whether it will be presented to the user in the
-// web application and the function that implements the pattern.
+// web application, the function that implements the pattern, and the size and
+// constructor of the state the pattern keeps between frames. State that grows
+// with the strip adds a number of bytes per LED on top of its fixed size.
+//
+// Patterns with several configs have no single handler. Instead, configs points
+// to one handler per config, and configs past the last one run config 0.
 //
 typedef struct {
   int index;
   const char *pattern_name;
   bool enabled;
-  void (*pattern_handler)(Strip_Buffer * buf, int len, Pattern_Data* params);
+  Pattern_Handler pattern_handler;
+  size_t state_size;
+  size_t state_per_led;
+  void (*state_init)(void * state);
+  const Pattern_Configs * configs;
 } Pattern;
 
 //
@@ -55,22 +63,27 @@ typedef struct {
 // in the UI or not. If not shown, it i snot selectable. If a pattern is not registered here,
 // It will not be selectable and the loop below will not know about it.
 //
+// Patterns that keep history between frames declare it with PATTERN_STATE(type),
+// or PATTERN_STATE_PER_LED(type, cell) if it has a cell for every LED. Patterns
+// that only keep a cell for every LED use PATTERN_CELLS(cell), and patterns
+// that keep nothing use NO_STATE.
+//
 Pattern mainPatterns[]{
-    { 0, "None", true, blank},
-    { 1, "Pixel Frequency", true, pix_freq},
-    { 2, "Confetti", true, confetti},
-    { 3, "Hue Trail", true, hue_trail},
-    { 4, "Saturated", true, saturated},
-    { 5, "Groovy", true, groovy},
-    { 6, "Talking", true, talking},
-    { 7, "Glitch", true, glitch},
-    { 8, "Bands", true, bands},
-    { 9, "Equalizer", true, eq},
-    { 10, "Tug of War", true, tug_of_war},
-    { 11, "Rain Drop", true, random_raindrop},
-    { 12, "Fire 2012", true, Fire2012},
-    { 13, "Bar Fill", true, bar_fill},
-    { 14, "Vowel Rain Drop", true, vowels_raindrop},
+    { 0, "None", true, blank, NO_STATE},
+    { 1, "Pixel Frequency", true, pix_freq, PATTERN_STATE(Pix_Freq_State)},
+    { 2, "Confetti", true, confetti, PATTERN_STATE(Particle_Pool)},
+    { 3, "Hue Trail", true, nullptr, NO_STATE, &hue_trail_configs},
+    { 4, "Saturated", true, nullptr, NO_STATE, &saturated_configs},
+    { 5, "Groovy", true, groovy, NO_STATE},
+    { 6, "Talking", true, nullptr, NO_STATE, &talking_configs},
+    { 7, "Glitch", true, nullptr, NO_STATE, &glitch_configs},
+    { 8, "Bands", true, nullptr, PATTERN_STATE(Bands_State), &bands_configs},
+    { 9, "Equalizer", true, eq, NO_STATE},
+    { 10, "Tug of War", true, nullptr, NO_STATE, &tug_of_war_configs},
+    { 11, "Rain Drop", true, random_raindrop, PATTERN_STATE(Particle_Pool)},
+    { 12, "Fire 2012", true, Fire2012, PATTERN_CELLS(byte)},
+    { 13, "Bar Fill", true, nullptr, NO_STATE, &bar_fill_configs},
+    { 14, "Vowel Rain Drop", true, vowels_raindrop, PATTERN_STATE(Particle_Pool)},
 };
 int NUM_PATTERNS = 15;  // MAKE SURE TO UPDATE THIS WITH THE ACTUAL NUMBER OF PATTERNS (+1 last array pos)
 
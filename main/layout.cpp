@@ -0,0 +1,170 @@
+/** @file
+  *
+  * This file's functions build the logical to physical pixel map,
+  * and apply it to finished frames.
+  *
+  * The map is a table with one entry per pixel, rebuilt only when
+  * the layout settings change. Applying it is a single lookup per
+  * pixel, done while the frame is handed to the output stage.
+  *
+*/
+
+#include <string.h>
+#include "nanolux_types.h"
+#include "arena.h"
+#include "layout.h"
+
+/// The physical pixel every logical pixel is wired to.
+static uint16_t * layout_map = nullptr;
+
+/// The number of pixels the map has room for.
+static uint16_t layout_len = 0;
+
+/// If the map sends every pixel to itself.
+static bool layout_identity = true;
+
+/// If every physical pixel is written by exactly one logical pixel.
+static bool layout_permutation = true;
+
+/// The width of the logical canvas, or 0 for one strip.
+static int canvas_width = 0;
+
+/// The settings the map was last built for.
+static Config_Data built;
+
+/// If the map has to be rebuilt even though the settings match.
+static bool layout_dirty = true;
+
+/// @brief Allocates the pixel map from the arena.
+/// @param len The number of pixels on the strip.
+///
+/// Call right after the arena is set up for a new length. The
+/// map is rebuilt by the next update_layout().
+void allocate_layout(uint16_t len){
+  layout_map = (uint16_t *) arena_alloc(sizeof(uint16_t) * len);
+  layout_len = (layout_map) ? len : 0;
+  layout_dirty = true;
+}
+
+/// @brief Maps the pixels of a grid of rows.
+/// @param width      The number of pixels in each wired row.
+/// @param height     The number of wired rows.
+/// @param rotation   Quarter turns clockwise to rotate the canvas by.
+/// @param serpentine If every other row is wired in reverse.
+static void build_grid(int width, int height, uint8_t rotation, bool serpentine){
+
+  // Quarter turns swap the canvas's width and height.
+  int lw = (rotation & 1) ? height : width;
+  int lh = (rotation & 1) ? width : height;
+
+  for (int ly = 0; ly < lh; ly++) {
+    for (int lx = 0; lx < lw; lx++) {
+      int px, py;
+
+      switch (rotation) {
+        case 1:  px = ly;             py = height - 1 - lx; break;
+        case 2:  px = width - 1 - lx; py = height - 1 - ly; break;
+        case 3:  px = width - 1 - ly; py = lx;              break;
+        default: px = lx;             py = ly;              break;
+      }
+
+      if (serpentine && (py & 1)) px = width - 1 - px;
+
+      layout_map[ly * lw + lx] = py * width + px;
+    }
+  }
+
+  canvas_width = lw;
+}
+
+/// @brief Rebuilds the pixel map if the layout settings changed.
+/// @param c The system settings holding the layout.
+void update_layout(const Config_Data * c){
+
+  if (!layout_dirty
+      && c->layout == built.layout
+      && c->layout_width == built.layout_width
+      && c->layout_rotation == built.layout_rotation
+      && c->length == built.length)
+    return;
+
+  built = *c;
+  layout_dirty = false;
+
+  layout_identity = true;
+  layout_permutation = true;
+  canvas_width = 0;
+
+  int len = min(c->length, layout_len);
+  for (int i = 0; i < len; i++)
+    layout_map[i] = i;
+
+  int width = c->layout_width;
+  int height = (width) ? len / width : 0;
+
+  switch (c->layout) {
+
+    case LAYOUT_ROWS:
+    case LAYOUT_SERPENTINE:
+      if (height < 1) return;
+      build_grid(width, height, c->layout_rotation, c->layout == LAYOUT_SERPENTINE);
+      layout_identity = false;
+      break;
+
+    case LAYOUT_CUSTOM: {
+      // Only the main loop reads the map, so it is loaded from
+      // storage straight into place.
+      uint16_t loaded = load_layout_map_from_nvs(layout_map, len);
+      for (int i = 0; i < loaded; i++)
+        if (layout_map[i] >= len) layout_map[i] = i;
+      canvas_width = (height > 1) ? width : 0;
+      layout_identity = false;
+      layout_permutation = false;
+      break;
+    }
+
+    default:
+      break;
+  }
+}
+
+/// @brief Replaces the custom layout map and saves it.
+/// @param map The physical pixel of every logical pixel.
+/// @param len The number of pixels in the map.
+///
+/// The map is kept in storage only, and loaded the next time
+/// the layout is rebuilt.
+void set_custom_layout(const uint16_t * map, uint16_t len){
+  save_layout_map_to_nvs(map, min(len, (uint16_t) MAX_LEDS));
+  layout_dirty = true;
+}
+
+/// @brief Finds the 2D canvas a pattern of (len) pixels draws on.
+/// @param len    The number of pixels the pattern draws.
+/// @param width  Set to the canvas width.
+/// @param height Set to the number of full rows in the canvas.
+/// @returns True if the canvas has more than one row and column.
+bool layout_canvas(int len, int * width, int * height){
+  *width = (canvas_width) ? canvas_width : len;
+  *height = (*width) ? len / *width : 0;
+  return canvas_width > 1 && *height > 1;
+}
+
+/// @brief Copies a frame, moving every pixel to where it is wired.
+/// @param out The physical frame to write.
+/// @param in  The logical frame to read.
+/// @param len The number of pixels in the frame, up to the strip length.
+void layout_apply(CRGB * out, const CRGB * in, uint16_t len){
+
+  if (layout_identity || len > layout_len) {
+    memcpy(out, in, sizeof(CRGB) * len);
+    return;
+  }
+
+  // Custom maps may leave physical pixels unwired.
+  if (!layout_permutation)
+    memset(out, 0, sizeof(CRGB) * len);
+
+  for (uint16_t i = 0; i < len; i++)
+    out[layout_map[i]] = in[i];
+}
@@ -0,0 +1,24 @@
+/**@file
+ *
+ * This file contains function headers for layout.cpp.
+ *
+ * Patterns draw on a logical canvas, in rows from the top left.
+ * The layout maps every logical pixel to the physical pixel it is
+ * wired to, so panels and multi-row strips show patterns upright
+ * no matter how they are wired.
+ *
+**/
+
+#ifndef LAYOUT_H
+#define LAYOUT_H
+
+#include <FastLED.h>
+#include "storage.h"
+
+void allocate_layout(uint16_t len);
+void update_layout(const Config_Data * c);
+void set_custom_layout(const uint16_t * map, uint16_t len);
+bool layout_canvas(int len, int * width, int * height);
+void layout_apply(CRGB * out, const CRGB * in, uint16_t len);
+
+#endif
@@ -14,6 +14,14 @@
 #include "core_analysis.h"
 #include "ext_analysis.h"
 #include "storage.h"
+#include "filterbank.h"
+#include "tempo.h"
+#include "arena.h"
+#include "parallel_render.h"
+#include "compositor.h"
+#include "output.h"
+#include "layout.h"
+#include "palette.h"
 #include "globals.h"
 
 #include <AiEsp32RotaryEncoder.h>
@@ -27,11 +35,30 @@ FASTLED_USING_NAMESPACE
 
 // #define SHOW_TIMINGS
 
-/// Unprocessed output buffer.
-CRGB output_buffer[MAX_LEDS]; 
+/// The number of LED buffers the arena holds for the strip: one per
+/// loaded pattern, plus the manual pattern, the outgoing pattern of a
+/// crossfade, the crossfade blend and the smoothed output.
+#define LED_BUFFER_COUNT (PATTERN_LIMIT + 4)
+
+/// The number of pattern states the arena holds at once: one per
+/// loaded pattern, plus the manual pattern and the outgoing pattern
+/// of a crossfade.
+#define STATE_SLOTS (PATTERN_LIMIT + 2)
+
+/// The strip length the LED buffers are sized for. Follows
+/// config.length when the patterns are next reset.
+uint16_t strip_length = 0;
+
+/// The config.length the LED buffers were last sized for. When
+/// memory runs short, strip_length ends up below it, and the
+/// buffers are not sized again until config.length changes.
+uint16_t requested_length = 0;
 
 /// Postprocessed output buffer.
-CRGB smoothed_output[MAX_LEDS];
+CRGB * smoothed_output = nullptr;
+
+/// The blend of a crossfading pattern with its replacement.
+CRGB * transition_output = nullptr;
 
 /// Contains the current state of the button (true is pressed).
 bool button_pressed = false;
@@ -39,15 +66,9 @@ bool button_pressed = false;
 /// Contains the peak frequency detected by the FFT.
 double peak = 0.;
 
-/// Contains the "base" hue, calculated from the peak frequency.
-uint8_t fHue = 0;
-
 /// Contains the current volume detected by the FFT.
 double volume = 0.;
 
-/// Contains the "base" brightness value, calculated from the current volume.
-uint8_t vbrightness = 0;
-
 /// Updated to "true" when the web server changes significant pattern settings.
 volatile bool pattern_changed = false;
 
@@ -63,6 +84,18 @@ Config_Data config;
 /// History of all currently-running patterns.
 Strip_Buffer histories[PATTERN_LIMIT];
 
+/// The settings each history buffer was last rendered with.
+Pattern_Data rendered_patterns[PATTERN_LIMIT];
+
+/// The crossfade from a replaced pattern, if one is running.
+Transition transition;
+
+/// The span of the strip each output channel sends.
+Channel_Span channel_spans[OUTPUT_CHANNELS];
+
+/// The number of output channels that send any LEDs.
+uint8_t channel_count = 1;
+
 /// The current list of patterns, externed from globals.h.
 extern Pattern mainPatterns[];
 
@@ -86,6 +119,7 @@ bool lastEncoderBtnPressed = false;
 void setup();
 void loop();
 void audio_analysis();
+void reset_patterns();
 
 /// @brief Sets up various objects needed by the device.
 ///
@@ -111,11 +145,17 @@ void setup() {
   attachInterrupt(BUTTON_PIN, buttonISR, FALLING);
 
   //  initialize up led strip
-  FastLED.addLeds<LED_TYPE, DATA_PIN, CLK_PIN, COLOR_ORDER>(smoothed_output, MAX_LEDS).setCorrection(TypicalLEDStrip);
+  setup_output();
+
+  filterbank_init(FILTERBANK_BANDS, SAMPLES, SAMPLING_FREQUENCY);
+  setup_tempo();
+  setup_parallel_render();
+  setup_palettes();
 
   load_from_nvs();
   verify_saves();
   load_slot(0);
+  reset_patterns();
 
 
 
@@ -125,18 +165,6 @@ void setup() {
 #endif
 }
 
-/// @brief Layers two CRGB arrays together and places the result in another array.
-/// @param a      The first array to layer.
-/// @param b      The second array to layer.
-/// @param out    The array to output to.
-/// @param length The number of pixels to layer.
-/// @param blur   The ratio between the first and second array in the output. 0-255.
-void calculate_layering(CRGB *a, CRGB *b, CRGB *out, int length, uint8_t blur) {
-  for (int i = 0; i < length; i++) {
-    out[i] = blend(a[i], b[i], blur);
-  }
-}
-
 /// @brief Checks if the web server has new data,
 /// and marks settings as dirty if required.
 /// 
@@ -152,147 +180,419 @@ void update_web_server() {
 #endif
 }
 
-/// @brief Scales all LEDs in a CRGB array by (factor)/255
-/// @param arr    The array to scale
-/// @param len    The number of LEDs to scale
-/// @param factor The factor to scale by. Divided by 255.
-void scale_crgb_array(CRGB *arr, uint8_t len, uint8_t factor) {
-  float_t scale_factor = ((float_t)factor) / 255;
-  for (int i = 0; i < len; i++) {
-    arr[i].r *= scale_factor;
-    arr[i].g *= scale_factor;
-    arr[i].b *= scale_factor;
+/// @brief Builds the view the compositor reads a pattern through.
+/// @param p   The pattern's settings.
+/// @param buf The pattern's buffer.
+/// @param len How many pixels of the strip the pattern covers.
+///
+/// Mirrored patterns render half the length. The compositor folds
+/// that half back across the right side, repeating the middle
+/// pixel when the length is odd.
+Pixel_View pattern_view(Pattern_Data * p, Strip_Buffer * buf, uint16_t len){
+
+  // Pull the current postprocessing effects from the struct integer.
+  uint8_t pp_mode = p->postprocessing_mode;
+
+  Pixel_View view;
+  view.leds = buf->leds;
+  view.reversed = pp_mode & 1;
+  view.mirrored = (pp_mode & 2) && len > 1;
+  view.len = (view.mirrored) ? len/2 : len;
+  return view;
+}
+
+/// @brief Clears a pattern's LED buffer and drops its state.
+/// @param buf The buffer to reset.
+/// @param idx The index of the pattern the buffer will run.
+///
+/// The state is reallocated from the arena the next time the
+/// pattern runs, so the arena should be reset alongside this.
+void reset_strip_buffer(Strip_Buffer * buf, uint8_t idx){
+  memset(buf->leds, 0, sizeof(CRGB) * strip_length);
+  buf->state = nullptr;
+  buf->idx = idx;
+}
+
+/// @brief Returns the number of bytes a pattern's state takes
+/// up on the current strip, or 0 if it keeps no state.
+/// @param idx The index of the pattern in the registry.
+size_t pattern_state_size(uint8_t idx){
+  const Pattern * pattern = &mainPatterns[idx];
+  return pattern->state_size + pattern->state_per_led * strip_length;
+}
+
+/// @brief Allocates and constructs a buffer's pattern state if it has
+/// none yet, and expands the pattern's palette.
+/// @param p   The settings of the pattern that will run.
+/// @param buf The buffer the pattern runs on.
+/// @returns False if the pattern needs state and the arena is out of room.
+///
+/// Only call this from the main loop. Patterns may render on the
+/// worker core, so the arena and palettes are never touched
+/// while rendering.
+bool prepare_pattern_state(Pattern_Data * p, Strip_Buffer * buf){
+
+  prepare_palette(p->palette);
+
+  size_t size = pattern_state_size(buf->idx);
+  if (!size || buf->state) return true;
+
+  buf->state = arena_alloc(size);
+  if (!buf->state) return false;
+
+  // Patterns with only per-LED cells start from the zeroed cells.
+  memset(buf->state, 0, size);
+  const Pattern * pattern = &mainPatterns[buf->idx];
+  if (pattern->state_init) pattern->state_init(buf->state);
+  return true;
+}
+
+/// @brief Finds the handler that renders a pattern's config.
+/// @param pattern The pattern to render.
+/// @param config  The pattern's selected config.
+Pattern_Handler config_handler(const Pattern * pattern, uint8_t config){
+  const Pattern_Configs * configs = pattern->configs;
+  if (!configs) return pattern->pattern_handler;
+  return configs->handlers[(config < configs->count) ? config : 0];
+}
+
+/// @brief Runs the pattern a buffer was prepared for.
+///
+/// @param p The settings to run the pattern with.
+/// @param buf The buffer to read/write to/from.
+/// @param len How many pixels this pattern can run on.
+///
+/// The pattern's state must have been prepared with
+/// prepare_pattern_state() first. The pattern run is the one in
+/// buf->idx, so a new index in (p) takes effect only once the
+/// main loop has reset the buffer for it.
+void process_pattern(Pattern_Data * p, Strip_Buffer * buf, uint16_t len){
+
+  // Leave the segment dark if there was no room for the pattern's state.
+  const Pattern * pattern = &mainPatterns[buf->idx];
+  if (pattern_state_size(buf->idx) && !buf->state) {
+    clearLEDSegment(buf, len);
+    return;
+  }
+
+  // Gather the audio features this pattern listens to.
+  Audio_Data audio;
+  get_band_audio(p, &audio.volume, &audio.peak);
+  audio.fHue = getFhue(audio.peak, p->minhue, p->maxhue);
+  audio.vbrightness = getVbrightness(audio.volume);
+
+  // Process the pattern. It always renders forward, and the
+  // compositor applies reversing and mirroring.
+  config_handler(pattern, p->config)(
+      buf,
+      pattern_view(p, buf, len).len,
+      p,
+      &audio);
+}
+
+/// @brief Packs the state of every running pattern to the start of the arena.
+///
+/// Frees the space left by patterns that stopped running.
+void compact_pattern_state(){
+
+  void ** blocks[PATTERN_LIMIT + 1];
+  size_t sizes[PATTERN_LIMIT + 1];
+
+  for (int i = 0; i < PATTERN_LIMIT; i++) {
+    blocks[i] = &histories[i].state;
+    sizes[i] = pattern_state_size(histories[i].idx);
   }
+
+  blocks[PATTERN_LIMIT] = &manual_strip_buffer.state;
+  sizes[PATTERN_LIMIT] = pattern_state_size(manual_strip_buffer.idx);
+
+  arena_compact(blocks, sizes, PATTERN_LIMIT + 1);
 }
 
-/// @brief Reverses the LED buffer supplied given a length.
-/// @param buf The LED buffer to reverse.
-/// @param len The length of the buffer to reverse.
-void reverse_buffer(CRGB* buf, uint8_t len){
+/// @brief Sizes the arena for the configured strip length, and
+/// allocates every LED buffer from it.
+///
+/// Pattern state is left room for on top of the buffers. If the
+/// buffers do not fit in memory, the strip is driven at half the
+/// length until they do. If even MIN_LEDS do not fit, there is
+/// nothing to render into, so the board halts and blinks.
+void allocate_led_buffers(){
+
+  // Leave room for the largest state in every state slot.
+  size_t state_size = 0;
+  size_t state_per_led = 0;
+  for (int i = 0; i < NUM_PATTERNS; i++) {
+    state_size = max(state_size, mainPatterns[i].state_size);
+    state_per_led = max(state_per_led, mainPatterns[i].state_per_led);
+  }
+
+  uint16_t len = config.length;
+
+  for (;;) {
+    size_t buffers = LED_BUFFER_COUNT * (sizeof(CRGB) * len + ARENA_ALIGN)
+                   + sizeof(uint16_t) * len + ARENA_ALIGN;
+    size_t state = STATE_SLOTS * (state_size + state_per_led * len + ARENA_ALIGN);
 
-    CRGB temp[MAX_LEDS];
-    memcpy(temp, buf, len * sizeof(CRGB));
+    if (arena_setup(buffers + state) && resize_output(len)) break;
 
-    for (int i = 0; i < len; i++) {
-      memcpy(&buf[i], &temp[len - 1 - i], sizeof(CRGB));
+    if (len <= MIN_LEDS) {
+      Serial.println("Not enough memory for the LED buffers.");
+      led_on_forever();
     }
+
+    len = max(len / 2, MIN_LEDS);
+  }
+
+  strip_length = len;
+  requested_length = config.length;
+
+  for (int i = 0; i < PATTERN_LIMIT; i++)
+    histories[i].leds = (CRGB *) arena_alloc(sizeof(CRGB) * len);
+
+  manual_strip_buffer.leds = (CRGB *) arena_alloc(sizeof(CRGB) * len);
+  transition.buffer.leds = (CRGB *) arena_alloc(sizeof(CRGB) * len);
+  transition_output = (CRGB *) arena_alloc(sizeof(CRGB) * len);
+  smoothed_output = (CRGB *) arena_alloc(sizeof(CRGB) * len);
+  allocate_layout(len);
+
+  arena_pin();
 }
 
-/// @brief Unfolds the buffer by mirroring it across the right side.
-/// @param buf The buffer to unfold.
-/// @param len The length to unfold.
-/// @param even If the LED strip length is even/odd. When odd, duplicates
-/// the middle pixel a second time to fill space.
-void unfold_buffer(CRGB* buf, uint8_t len, bool even){
+/// @brief Clears every pattern buffer, the output and the arena.
+///
+/// Used when a change affects the whole strip, such as a new
+/// pattern count, strip length or layout.
+void reset_patterns(){
+  if (config.length != requested_length)
+    allocate_led_buffers();
+
+  update_layout(&config);
+  memset(smoothed_output, 0, sizeof(CRGB) * strip_length);
+
+  channel_count = split_channels(config.channel_length, OUTPUT_CHANNELS, strip_length, channel_spans);
+  set_output_channels(channel_spans);
 
-  uint8_t offset = 0;
+  arena_reset();
 
-  // If this is not an even case, increase our array offset by 1 and
-  // make the pixel at len equal to the pixel at len-1
-  if(!even){
-    buf[len] = buf[len-1];
-    offset = 1;
+  for (int i = 0; i < PATTERN_LIMIT; i++) {
+    rendered_patterns[i] = loaded_patterns.pattern[i];
+    reset_strip_buffer(&histories[i], rendered_patterns[i].idx);
   }
+  reset_strip_buffer(&manual_strip_buffer, manual_pattern.idx);
+
+  transition.active = false;
+  transition.buffer.state = nullptr;
+}
 
-  // Unfold the array following the set offset.
-  for(int i = 0; i < len; i++){
-    buf[len + i + offset] = buf[len-i-1];
+/// @brief Drops the outgoing pattern of the running crossfade.
+void end_transition(){
+  if (!transition.active) return;
+
+  transition.active = false;
+  transition.buffer.state = nullptr;
+  compact_pattern_state();
+}
+
+/// @brief Finishes a crossfade that ran its course, and starts
+/// crossfading a loaded pattern that was replaced.
+///
+/// Only one crossfade runs at a time, so a transition costs one
+/// extra pattern render. If another pattern is replaced while a
+/// crossfade runs, the running one is cut short.
+void update_transitions(){
+
+  if (transition.active && millis() - transition.start >= config.transition_ms)
+    end_transition();
+
+  for (int i = 0; i < loaded_patterns.pattern_count; i++) {
+    // Read the index once, as the web server may change it.
+    uint8_t idx = loaded_patterns.pattern[i].idx;
+    if (idx == histories[i].idx) continue;
+
+    end_transition();
+
+    // Hand the old pattern's buffer, state and settings to the
+    // transition, and start the new pattern from the transition's
+    // spare buffer. The web server has already overwritten the
+    // loaded slot, so the settings come from the last render.
+    CRGB * spare = transition.buffer.leds;
+    transition.outgoing = rendered_patterns[i];
+    transition.buffer = histories[i];
+    transition.slot = i;
+    transition.start = millis();
+    transition.active = true;
+
+    histories[i].leds = spare;
+    reset_strip_buffer(&histories[i], idx);
+
+    if (!config.transition_ms) end_transition();
+    return;
   }
 }
 
-/// @brief Runs a specified pattern and performs postprocessing effects on it.
+/// @brief Renders loaded pattern (index) into its history buffer.
+/// @param index The index of the loaded pattern to render. One past
+/// the last loaded pattern renders the outgoing pattern of a crossfade.
+/// @param ctx   Points to the uint16_t length every loaded pattern renders on.
 ///
-/// @param p The pattern to run.
-/// @param buf The buffer to read/write to/from.
-/// @param len How many pixels this pattern can run on.
-void process_pattern(Pattern_Data * p, Strip_Buffer * buf, uint8_t len){
+/// Called through parallel_for(), so patterns may render on
+/// either core.
+void render_loaded_pattern(int index, void * ctx){
 
-  // Pull the current postprocessing effects from the struct integer.
-  uint8_t pp_mode = p->postprocessing_mode;
-  bool is_reversed = pp_mode & 1;
-  bool is_mirrored = pp_mode & 2;
+  const uint16_t * lengths = (const uint16_t *) ctx;
 
-  getFhue(p->minhue, p->maxhue);
-  getVbrightness();
-  // Calculate the length to process
-  uint8_t processed_len = (is_mirrored) ? len/2 : len;
+  if (index >= loaded_patterns.pattern_count) {
+    process_pattern(&transition.outgoing, &transition.buffer, lengths[transition.slot]);
+    return;
+  }
 
-  // Reverse the buffer to make it normal if it is reversed.
-  if(is_reversed) reverse_buffer(buf->leds, processed_len);
+  process_pattern(
+    &rendered_patterns[index],
+    &histories[index],
+    lengths[index]);
+}
 
-  // Process the pattern.
-  mainPatterns[p->idx].pattern_handler(
-      buf,
-      processed_len,
-      p);
-  
-  // Re-invert the buffer if we need the output to be reversed.
-  if(is_reversed) reverse_buffer(buf->leds, processed_len);
-
-  // Unfold the buffer if needed.
-  if(is_mirrored) 
-    unfold_buffer(buf->leds, processed_len, (len == processed_len * 2));
+/// @brief Renders the first (count) loaded patterns across both cores.
+/// @param count   The number of patterns to render.
+/// @param lengths The number of pixels each pattern renders on.
+///
+/// Also renders the outgoing pattern of a running crossfade.
+///
+/// Each pattern renders with a snapshot of its settings. Once the
+/// web server replaces a pattern, its snapshot is no longer
+/// refreshed, so the outgoing pattern keeps the settings it had.
+void render_loaded_patterns(uint8_t count, uint16_t * lengths){
+
+  // Allocate state up front, as the arena is not thread safe.
+  for (int i = 0; i < count; i++) {
+    if (loaded_patterns.pattern[i].idx == histories[i].idx)
+      rendered_patterns[i] = loaded_patterns.pattern[i];
+    prepare_pattern_state(&rendered_patterns[i], &histories[i]);
+  }
+
+  if (transition.active) {
+    prepare_pattern_state(&transition.outgoing, &transition.buffer);
+    count++;
+  }
+
+  parallel_for(render_loaded_pattern, lengths, count);
 }
 
-/// @brief  Runs the strip splitting LED strip mode
+/// @brief Builds the layer the compositor reads a loaded pattern as.
+/// @param i   The index of the loaded pattern.
+/// @param len How many pixels of the strip the pattern covers.
 ///
-/// This function allocates a number of LEDs per pattern, then
-/// moves LED data from the pattern's history buffer to the
-/// unsmoothed output buffer.
+/// While the pattern is crossfading, the layer reads a blend of
+/// the outgoing and incoming pattern instead. Each side keeps its
+/// own brightness, reversing and mirroring, the opacity fades
+/// between them, and the blend mode switches halfway through.
+Layer loaded_pattern_layer(uint8_t i, uint16_t len){
+
+  Pattern_Data * p = &rendered_patterns[i];
+
+  Layer layer;
+  layer.view = pattern_view(p, &histories[i], len);
+  layer.brightness = p->brightness;
+  layer.opacity = p->opacity;
+  layer.blend_mode = p->blend_mode;
+  if (!transition.active || transition.slot != i) return layer;
+
+  uint32_t elapsed = millis() - transition.start;
+  uint8_t progress = (config.transition_ms)
+    ? min(elapsed * 255 / config.transition_ms, (uint32_t) 255)
+    : 255;
+
+  // The two sides may map onto the strip differently, so they
+  // are blended in strip order.
+  Pattern_Data * old = &transition.outgoing;
+  Pixel_View from = pattern_view(old, &transition.buffer, len);
+
+  for (int j = 0; j < len; j++) {
+    CRGB a = view_pixel(&from, j, len).nscale8(old->brightness);
+    CRGB b = view_pixel(&layer.view, j, len).nscale8(p->brightness);
+    transition_output[j] = blend(a, b, progress);
+  }
+
+  layer.view.leds = transition_output;
+  layer.view.len = len;
+  layer.view.reversed = false;
+  layer.view.mirrored = false;
+  layer.brightness = 255;
+  layer.opacity = lerp8by8(old->opacity, p->opacity, progress);
+  if (progress < 128) layer.blend_mode = old->blend_mode;
+  return layer;
+}
+
+/// @brief Splits the strip into one section per loaded pattern.
+/// @param count   The number of loaded patterns.
+/// @param offsets Set to the first pixel of each section.
+/// @param lengths Set to the number of pixels in each section.
 ///
-/// Once the data is in the unsmoothed buffer, the buffer is
-/// "smoothed" into the output smoothed buffer.
+/// When there is one pattern per output channel, each pattern
+/// covers one channel's strip. Otherwise, the strip is split
+/// into equal sections.
+void split_strip(uint8_t count, uint16_t * offsets, uint16_t * lengths){
+
+  if (count > 1 && count == channel_count) {
+    for (int i = 0; i < count; i++) {
+      offsets[i] = channel_spans[i].offset;
+      lengths[i] = channel_spans[i].length;
+    }
+    return;
+  }
+
+  uint16_t section_length = strip_length / count;
+  for (int i = 0; i < count; i++) {
+    offsets[i] = section_length * i;
+    lengths[i] = section_length;
+  }
+}
+
+/// @brief  Runs the strip splitting LED strip mode
+///
+/// This function allocates a number of LEDs per pattern and
+/// renders every pattern, split between both cores. Once all
+/// patterns are done, each pattern's history buffer is scaled
+/// by its brightness and smoothed into its section of the
+/// smoothed output buffer in a single pass.
 void run_strip_splitting() {
 
-  // Defines the length of an LED strip segment
-  uint8_t section_length = config.length / loaded_patterns.pattern_count;
+  // Defines the section of the strip each pattern covers
+  uint16_t offsets[PATTERN_LIMIT];
+  uint16_t lengths[PATTERN_LIMIT];
+  split_strip(loaded_patterns.pattern_count, offsets, lengths);
 
-  // Repeat for each pattern
-  for (int i = 0; i < loaded_patterns.pattern_count; i++) {
+  // Run the pattern handler for every pattern using its history
+  render_loaded_patterns(loaded_patterns.pattern_count, lengths);
 
-    // Run the pattern handler for pattern i using history i
-    process_pattern(&loaded_patterns.pattern[i], &histories[i], section_length);
-
-    // Copy the processed segment to the output buffer
-    memcpy(
-      &output_buffer[section_length * i],
-      histories[i].leds,
-      sizeof(CRGB) * section_length);
-
-    // Scale the LED strip light output based on brightness
-    scale_crgb_array(
-      &output_buffer[section_length * i],
-      section_length,
-      loaded_patterns.pattern[i].brightness);
-
-    // Smooth the brightness-adjusted output and put it
-    // into the main output buffer.
-    calculate_layering(
-      &smoothed_output[section_length * i],
-      &output_buffer[section_length * i],
-      &smoothed_output[section_length * i],
-      section_length,
-      255 - loaded_patterns.pattern[i].smoothing);
+  // Composite each pattern into its section of the output.
+  for (int i = 0; i < loaded_patterns.pattern_count; i++) {
+    Layer layer = loaded_pattern_layer(i, lengths[i]);
+    composite_segment(
+      &smoothed_output[offsets[i]],
+      lengths[i],
+      &layer.view,
+      layer.brightness,
+      loaded_patterns.pattern[i].smoothing);
   }
 }
 
 /// @brief Runs the pattern layering output mode
 ///
-/// This function layers two patterns onto each other,
-/// covering the entire length of the LED strip.
+/// This function stacks every loaded pattern as a layer
+/// covering the entire length of the LED strip, with the
+/// first pattern on the bottom. All patterns render at the
+/// same time, split between both cores.
 ///
-/// Each pattern buffer is moved into a temp buffer, which
-/// scales the brightness of each pattern according to user
-/// settings.
+/// Each layer blends onto the ones below it using its blend
+/// mode and opacity. The strip's alpha scales the opacity of
+/// every layer above the first, so with two normal layers it
+/// is the ratio between them.
 ///
-/// Then, the patterns are merged into the unsmoothed buffer,
-/// which then is combined with the smoothed buffer.
+/// The stack is composited and smoothed into the output in
+/// a single pass.
 void run_pattern_layering() {
 
-  // Create two CRGB buffers for holding LED strip data
-  // that has been light-adjusted.
-  static CRGB temps[2][MAX_LEDS];
-
   // If there is one pattern pattern, run strip splitting,
   // which will output the single pattern.
   if (loaded_patterns.pattern_count < 2) {
@@ -300,47 +600,30 @@ void run_pattern_layering() {
     return;
   }
 
-  // If there are more than two patterns, use the first two
-  // for pattern layering.
-  uint8_t section_length = config.length;
-  for (uint8_t i = 0; i < 2; i++) {
-    // Run the pattern handler for pattern i using history i
-    process_pattern(&loaded_patterns.pattern[i], &histories[i], section_length);
-
-    // Copy the processed segment to the temp buffer
-    memcpy(
-      temps[i],
-      histories[i].leds,
-      sizeof(CRGB) * config.length);
-
-    // Scale the temp buffer light output based on brightness
-    scale_crgb_array(
-      temps[i],
-      config.length,
-      loaded_patterns.pattern[i].brightness);
-  }
+  uint16_t lengths[PATTERN_LIMIT];
+  for (int i = 0; i < PATTERN_LIMIT; i++)
+    lengths[i] = strip_length;
 
-  // Combine the two temp arrays.
-  calculate_layering(
-    temps[0],
-    temps[1],
-    output_buffer,
-    config.length,
-    loaded_patterns.alpha);
+  render_loaded_patterns(loaded_patterns.pattern_count, lengths);
 
-  // Smooth the combined layered output buffer.
-  calculate_layering(
-    smoothed_output,
-    output_buffer,
+  Layer layers[PATTERN_LIMIT];
+  for (uint8_t i = 0; i < loaded_patterns.pattern_count; i++) {
+    layers[i] = loaded_pattern_layer(i, strip_length);
+    if (i) layers[i].opacity = scale8(layers[i].opacity, loaded_patterns.alpha);
+  }
+
+  composite_stack(
     smoothed_output,
-    config.length,
-    255 - loaded_patterns.pattern[0].smoothing);
+    strip_length,
+    layers,
+    loaded_patterns.pattern_count,
+    loaded_patterns.pattern[0].smoothing);
 }
 
 /// @brief Prints a buffer to serial.
 /// @param buf  The CRGB buffer to print.
 /// @param len  The number of RGB values to print.
-void print_buffer(CRGB *buf, uint8_t len) {
+void print_buffer(CRGB *buf, uint16_t len) {
   for (int i = 0; i < len; i++) {
     Serial.print(String(buf[i].r) + "," + String(buf[i].g) + "," + String(buf[i].b) + " ");
   }
@@ -384,6 +667,7 @@ void update_hardware(){
     if(button_pressed){
       manual_pattern.idx = (manual_control_enabled + manual_pattern.idx) % NUM_PATTERNS;
       manual_control_enabled = true;
+      pattern_changed = true;
     }
 
     reset_button_state();  // Check for user button input
@@ -402,42 +686,33 @@ void loop() {
   audio_analysis();  // Run the audio analysis pipeline
   update_hardware(); // Pull updates from hardware (buttons, encoder)
 
-  // Reset buffers if pattern settings were changed since
-  // last program loop.
+  // Reset buffers if strip settings were changed since
+  // last program loop. Patterns replaced one at a time
+  // crossfade instead.
   if (pattern_changed) {
     pattern_changed = false;
-    memset(smoothed_output, 0, sizeof(CRGB) * MAX_LEDS);
-    memset(output_buffer, 0, sizeof(CRGB) * MAX_LEDS);
-    histories[0] = Strip_Buffer();
-    histories[1] = Strip_Buffer();
-    histories[2] = Strip_Buffer();
-    histories[3] = Strip_Buffer();
-    manual_strip_buffer = Strip_Buffer();
-  } 
+    reset_patterns();
+  } else {
+    update_transitions();
+  }
 
   if(manual_control_enabled){
 
+    prepare_pattern_state(&manual_pattern, &manual_strip_buffer);
     process_pattern(
       &manual_pattern,
       &manual_strip_buffer,
-      config.length
+      strip_length
     );
 
-    // Copy the processed segment to the temp buffer
-    memcpy(
-      output_buffer,
-      manual_strip_buffer.leds,
-      sizeof(CRGB) * config.length
-    );
-
-    // Smooth the brightness-adjusted output and put it
-    // into the main output buffer.
-    calculate_layering(
+    // Smooth the output and put it into the main output buffer.
+    Pixel_View view = pattern_view(&manual_pattern, &manual_strip_buffer, strip_length);
+    composite_segment(
       smoothed_output,
-      output_buffer,
-      smoothed_output,
-      config.length,
-      255 - 125);
+      strip_length,
+      &view,
+      255,
+      125);
 
   }else{
     switch (loaded_patterns.mode) {
@@ -454,11 +729,11 @@ void loop() {
     }
   }
 
-  FastLED.show();  // Push changes from the smoothed buffer to the LED strip
+  show_frame(smoothed_output, strip_length);  // Push changes from the smoothed buffer to the LED strip
 
   // Print the LED strip buffer if the simulator is enabled.
   if (config.debug_mode == 2)
-    print_buffer(smoothed_output, config.length);
+    print_buffer(smoothed_output, strip_length);
 
   // Update the web server while waiting for the current
   // frame to complete.
@@ -491,6 +766,14 @@ void audio_analysis() {
 
   noise_gate(loaded_patterns.noise_thresh);
 
+  update_vowel();
+
+  update_log_bands();
+
+  update_tempo(volume, millis());
+
+  update_band_focus(loaded_patterns.pattern, loaded_patterns.pattern_count);
+
   #ifdef SHOW_TIMINGS
     const int end = micros();
     Serial.printf("Audio analysis: %d ms\n", (end - start) / 1000);
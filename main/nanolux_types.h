@@ -41,11 +41,20 @@ enum VowelSounds {
 #define ROTARY_ENCODER_STEPS 4
 
 // FastLED
-#define MAX_LEDS    200
-#define DATA_PIN    15      // No hardware SPI pins defined for the ESP32 yet.
-#define CLK_PIN     14      // Use bitbanged output.
+#define MIN_LEDS    30
+#define MAX_LEDS    1500    // LED buffers are sized by the configured length, up to this.
+#define DATA_PIN    15      // Routed to the SPI peripheral through the GPIO matrix.
+#define CLK_PIN     14
+#define CHANNEL_1_DATA_PIN 25  // The second output channel's strip.
+#define CHANNEL_1_CLK_PIN  26
 #define LED_TYPE    SK9822  // Define LED protocol.
 #define COLOR_ORDER BGR     // Define color color order.
+#define LED_CORRECTION TypicalLEDStrip
+
+// SPI LED output. Comment out SPI_LED_OUTPUT to fall back
+// to FastLED's bitbanged output.
+#define SPI_LED_OUTPUT
+#define LED_SPI_CLOCK      8000000 // Hz. SK9822 strips take up to 30 MHz over short runs.
 #define MAX_BRIGHTNESS     255
 #define FRAMES_PER_SECOND  120
 
@@ -55,10 +64,38 @@ enum VowelSounds {
 #define NOISE_GATE_THRESH   20
 #define MAX_NOISE_GATE_THRESH   100
 
+// Log-spaced filterbank
+#define FILTERBANK_BANDS    24      // 16, 24 or 32 work well, up to FILTERBANK_MAX_BANDS
+
 // Mode Constants
 #define STRIP_SPLITTING 0
 #define Z_LAYERING      1
 
+// The longest time a pattern change can crossfade for, in ms.
+#define MAX_TRANSITION_MS 2000
+
+// Pixel Layouts
+#define LAYOUT_LINEAR     0 // One strip, in order.
+#define LAYOUT_ROWS       1 // Rows that all run the same direction.
+#define LAYOUT_SERPENTINE 2 // Rows that alternate direction.
+#define LAYOUT_CUSTOM     3 // A map uploaded through the API.
+#define NUM_LAYOUTS       4
+
+// Layer Blend Modes
+#define BLEND_NORMAL    0
+#define BLEND_ADD       1
+#define BLEND_SCREEN    2
+#define BLEND_MAX       3
+#define BLEND_MULTIPLY  4
+#define NUM_BLEND_MODES 5
+
+// Color Palettes
+#define PALETTE_HOT      0 // Black through red and yellow to white.
+#define PALETTE_HUE      1 // Every hue, red to red.
+#define PALETTE_EVIL     2 // Bands of deep red, orange and tan.
+#define PALETTE_NRWC     3 // Dark greens through yellow to orange.
+#define NUM_PALETTES     4
+
 // Button Input
 #define BUTTON_PIN 33
 
@@ -89,6 +126,9 @@ enum VowelSounds {
 ******************************************************************************/
 #define SPARKING 72
 
+// How much of its brightness a rain drop loses every frame, out of 255.
+#define RAINDROP_FADE 16
+
 // Used in Pix_Hue_Freq
 #define VOL_SHOW true
 
@@ -76,6 +76,18 @@ void bound_byte(uint8_t * val, int lower, int upper){
   }
 }
 
+/// @brief Bounds a 16-bit value between an upper and a lower value.
+/// @param val    The pointer to the value to modify.
+/// @param lower  The lower value the value can be.
+/// @param upper  The upper value the value can be.
+void bound_word(uint16_t * val, int lower, int upper){
+  if(*val > upper){
+    *val = upper;
+  }else if(*val < lower){
+    *val = lower;
+  }
+}
+
 /// @brief Remaps a value in one range to another range.
 ///
 /// @param x  The value to remap.
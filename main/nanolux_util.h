@@ -17,7 +17,9 @@ void IRAM_ATTR button_up();
 void begin_loop_timer(long ms);
 long timer_overrun();
 void bound_byte(uint8_t * val, int lower, int upper);
+void bound_word(uint16_t * val, int lower, int upper);
 void process_reset_button(int button_value);
+void led_on_forever();
 void nanolux_serial_print(char * msg);
 void IRAM_ATTR readEncoderISR();
 void setup_rotary_encoder();
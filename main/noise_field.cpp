@@ -0,0 +1,132 @@
+/** @file
+  *
+  * This file's functions fill LED buffers with smooth noise.
+  *
+  * Every octave of noise is sampled on its own lattice. Its
+  * spacing follows how many pixels one cell of the noise spans,
+  * so slow octaves take few samples and fast ones take many.
+  * Pixels between two samples are interpolated in fixed point.
+  *
+  * Sampled pixels match fill_noise16() exactly. Unlike
+  * fill_noise16(), strips longer than 255 LEDs are filled to the
+  * end, and no scratch arrays are put on the stack.
+  *
+*/
+
+#include <FastLED.h>
+#include <string.h>
+#include "noise_field.h"
+#include "palette.h"
+
+/// @brief Picks how many pixels apart an octave is sampled.
+/// @param cell    How far apart the noise lattice points are, in noise units.
+/// @param samples How many samples to take across one cell.
+/// @param scale   How far apart two pixels are, in noise units.
+static int lattice_step(uint32_t cell, uint32_t samples, uint32_t scale){
+  if (!scale) return NOISE_MAX_STEP;
+  return constrain(cell / (scale * samples), (uint32_t) 1, (uint32_t) NOISE_MAX_STEP);
+}
+
+/// @brief Samples one octave of a layer at one pixel.
+/// @param hue    If this is the hue layer, which uses 8-bit noise.
+/// @param pos    The pixel's position in the noise, in noise units.
+/// @param time   The time coordinate of the noise.
+/// @param octave The octave, which divides the noise by 2^octave.
+static uint32_t sample(bool hue, uint32_t pos, uint16_t time, uint8_t octave){
+  return hue ? (inoise8(pos, time) >> octave) : (inoise16(pos, time) >> octave);
+}
+
+/// @brief Adds one octave's sample onto a pixel's layer.
+///
+/// The value layer is kept in the red channel and the hue layer
+/// in the green channel until the colors are filled in. Both
+/// accumulate the way fill_noise16() does.
+static void accumulate(CRGB * led, bool hue, uint32_t n){
+  if (hue) {
+    led->g = qadd8(led->g, n);
+  } else {
+    uint32_t accum = ((uint32_t) led->r << 8) + n;
+    led->r = min(accum, (uint32_t) 65535) >> 8;
+  }
+}
+
+/// @brief Adds one octave of noise to a layer of every pixel.
+/// @param leds   The buffer holding the layers.
+/// @param len    The number of pixels.
+/// @param hue    If this is the hue layer.
+/// @param x      The position of the first pixel, in noise units.
+/// @param scale  How far apart two pixels are, in noise units.
+/// @param time   The time coordinate of the noise.
+/// @param octave The octave to add.
+static void add_octave(CRGB * leds, int len, bool hue, uint32_t x, uint32_t scale,
+                       uint16_t time, uint8_t octave){
+
+  x <<= octave;
+  scale <<= octave;
+
+  int step = hue ? lattice_step(256, NOISE_HUE_CELL_SAMPLES, scale)
+                 : lattice_step(65536, NOISE_CELL_SAMPLES, scale);
+
+  // Nothing to interpolate, so skip the divisions.
+  if (step == 1) {
+    for (int i = 0; i < len; i++, x += scale)
+      accumulate(&leds[i], hue, sample(hue, x, time, octave));
+    return;
+  }
+
+  int i0 = 0;
+  uint32_t a = sample(hue, x, time, octave);
+
+  for (;;) {
+    int i1 = min(i0 + step, len - 1);
+    if (i1 == i0) {
+      accumulate(&leds[i0], hue, a);
+      return;
+    }
+
+    uint32_t b = sample(hue, x + i1 * scale, time, octave);
+
+    // Walk from a to b in Q8.
+    int32_t n = a << 8;
+    int32_t slope = (((int32_t) b - (int32_t) a) << 8) / (i1 - i0);
+    for (int i = i0; i < i1; i++, n += slope)
+      accumulate(&leds[i], hue, n >> 8);
+
+    if (i1 == len - 1) {
+      accumulate(&leds[i1], hue, b);
+      return;
+    }
+
+    i0 = i1;
+    a = b;
+  }
+}
+
+/// @brief Fills a buffer with noise colors, like fill_noise16().
+/// @param leds        The buffer to fill.
+/// @param len         The number of LEDs to fill.
+/// @param octaves     The number of octaves of brightness noise.
+/// @param x           Where the brightness noise starts.
+/// @param scale       How quickly the brightness noise changes along the strip.
+/// @param hue_octaves The number of octaves of hue noise.
+/// @param hue_x       Where the hue noise starts.
+/// @param hue_scale   How quickly the hue noise changes along the strip.
+/// @param time        The time coordinate of both noises.
+/// @param hue_shift   Added to every hue.
+void fill_noise_field(CRGB * leds, int len, uint8_t octaves, uint16_t x, int scale,
+                      uint8_t hue_octaves, uint16_t hue_x, int hue_scale,
+                      uint16_t time, uint8_t hue_shift){
+
+  if (len <= 0) return;
+
+  memset(leds, 0, sizeof(CRGB) * len);
+
+  for (uint8_t o = 0; o < min(octaves, (uint8_t) NOISE_MAX_OCTAVES); o++)
+    add_octave(leds, len, false, x, scale, time, o);
+
+  for (uint8_t o = 0; o < min(hue_octaves, (uint8_t) NOISE_MAX_OCTAVES); o++)
+    add_octave(leds, len, true, hue_x, hue_scale, time, o);
+
+  for (int i = 0; i < len; i++)
+    leds[i] = hue_color(leds[i].g + hue_shift, leds[i].r);
+}
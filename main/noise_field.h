@@ -0,0 +1,34 @@
+/**@file
+ *
+ * This file contains function headers for noise_field.cpp.
+ *
+ * The noise field fills a strip the same way as FastLED's
+ * fill_noise16(), but only evaluates the noise every few pixels
+ * and interpolates the pixels in between.
+ *
+**/
+
+#ifndef NOISE_FIELD_H
+#define NOISE_FIELD_H
+
+#include <FastLED.h>
+
+/// The number of samples taken across one cell of the noise lattice.
+#define NOISE_CELL_SAMPLES 4
+
+/// The same for hue. 8-bit noise is coarse, and hue errors show
+/// as wrong colors rather than as brightness, so it is sampled
+/// more densely.
+#define NOISE_HUE_CELL_SAMPLES 8
+
+/// The most pixels ever interpolated between two samples.
+#define NOISE_MAX_STEP 16
+
+/// Octaves past this one are too faint to change an 8-bit result.
+#define NOISE_MAX_OCTAVES 8
+
+void fill_noise_field(CRGB * leds, int len, uint8_t octaves, uint16_t x, int scale,
+                      uint8_t hue_octaves, uint16_t hue_x, int hue_scale,
+                      uint16_t time, uint8_t hue_shift);
+
+#endif
@@ -0,0 +1,216 @@
+/** @file
+  *
+  * This file's functions send finished frames to the LED strip.
+  *
+  * Frames are sent by an output task that runs at its own rate of
+  * FRAMES_PER_SECOND, independent of the main loop. The task keeps
+  * the last two frames the loop rendered and sends frames that
+  * interpolate between them, so fades stay smooth while patterns
+  * and analysis run at the slower loop rate. This delays the
+  * output by one loop.
+  *
+  * show_frame() fills a back buffer and swaps it with the pending
+  * frame, so the loop never waits while a frame is being sent.
+  * The swaps and the blending live in frame_exchange.cpp, and
+  * this file adds the locking and the task around them.
+  *
+  * The frame buffers are sized for the strip length, and are
+  * reallocated by resize_output() while the task is held.
+  *
+  * A frame covers every output channel back to back. Each
+  * channel sends its own span of the frame to its own strip,
+  * and all channels are sent at the same time.
+  *
+  * Sending a frame to the strip takes much longer than checking
+  * if it changed. Frames identical to the last one sent are
+  * skipped, such as during silence or once smoothing has settled.
+  *
+*/
+
+#include <Arduino.h>
+#include <stdlib.h>
+#include <string.h>
+#include "nanolux_types.h"
+#include "output.h"
+#include "storage.h"
+#include "channels.h"
+#include "sk9822.h"
+#include "layout.h"
+#include "frame_exchange.h"
+
+#if OUTPUT_CHANNELS > 2
+#error "Pins are only defined for two output channels."
+#endif
+
+/// The frame buffers shared between the loop and the output task.
+static CRGB * frames = nullptr;
+
+/// The number of LEDs every frame buffer holds.
+static uint16_t frame_capacity = 0;
+
+/// The frame buffers handed from the loop to the output task.
+static Frame_Exchange exchange;
+
+/// Held by the output task while it uses the frame buffers.
+static SemaphoreHandle_t frames_lock;
+
+/// Guards the pending frame and its details.
+static portMUX_TYPE pending_lock = portMUX_INITIALIZER_UNLOCKED;
+
+/// The span of the frame each output channel sends.
+static Channel_Span channel_spans[OUTPUT_CHANNELS];
+
+#ifndef SPI_LED_OUTPUT
+/// The FastLED controller each output channel goes through.
+static CLEDController * controllers[OUTPUT_CHANNELS];
+#endif
+
+/// Counts of the frames sent and skipped.
+static Output_Stats output_stats;
+
+/// @brief Sends the sent frame to every output channel.
+/// @param len The number of LEDs to send.
+static void send_frame(uint16_t len){
+#ifdef SPI_LED_OUTPUT
+  send_channels(exchange.sent, len, channel_spans, OUTPUT_CHANNELS,
+                SK9822_MAX_BRIGHTNESS, LED_CORRECTION, sk9822_sink());
+#else
+  for (int ch = 0; ch < OUTPUT_CHANNELS; ch++)
+    controllers[ch]->setLeds(&exchange.sent[channel_spans[ch].offset], channel_length(&channel_spans[ch], len));
+  FastLED.show();
+#endif
+}
+
+/// @brief Sends interpolated frames at FRAMES_PER_SECOND.
+static void output_loop(void * arg){
+
+  TickType_t wake = xTaskGetTickCount();
+
+  for(;;){
+    vTaskDelayUntil(&wake, pdMS_TO_TICKS(1000 / FRAMES_PER_SECOND));
+
+    xSemaphoreTake(frames_lock, portMAX_DELAY);
+
+    uint16_t len = 0;
+    uint32_t arrival = 0;
+
+    portENTER_CRITICAL(&pending_lock);
+    bool taken = frame_take(&exchange, &len, &arrival);
+    portEXIT_CRITICAL(&pending_lock);
+
+    uint32_t now = millis();
+
+    if (!frame_advance(&exchange, taken, len, arrival, now)) {
+      output_stats.skipped++;
+      xSemaphoreGive(frames_lock);
+      continue;
+    }
+
+    uint32_t send_start = micros();
+    send_frame(exchange.sent_len);
+
+    output_stats.send_us = micros() - send_start;
+    output_stats.shown++;
+    output_stats.last_show = now;
+
+    xSemaphoreGive(frames_lock);
+  }
+}
+
+/// @brief Starts the LED driver and the output task.
+///
+/// Nothing is sent until resize_output() sizes the frame
+/// buffers for the strip.
+void setup_output(){
+
+  frames_lock = xSemaphoreCreateMutex();
+
+#ifdef SPI_LED_OUTPUT
+  sk9822_begin(0, DATA_PIN, CLK_PIN, LED_SPI_CLOCK);
+#if OUTPUT_CHANNELS > 1
+  sk9822_begin(1, CHANNEL_1_DATA_PIN, CHANNEL_1_CLK_PIN, LED_SPI_CLOCK);
+#endif
+#else
+  // FastLED takes pins as template arguments, so each channel
+  // is added on its own.
+  controllers[0] = &FastLED.addLeds<LED_TYPE, DATA_PIN, CLK_PIN, COLOR_ORDER>(exchange.sent, 0);
+#if OUTPUT_CHANNELS > 1
+  controllers[1] = &FastLED.addLeds<LED_TYPE, CHANNEL_1_DATA_PIN, CHANNEL_1_CLK_PIN, COLOR_ORDER>(exchange.sent, 0);
+#endif
+  for (int ch = 0; ch < OUTPUT_CHANNELS; ch++)
+    controllers[ch]->setCorrection(LED_CORRECTION);
+#endif
+
+  xTaskCreatePinnedToCore(
+    output_loop,
+    "output",
+    OUTPUT_TASK_STACK,
+    nullptr,
+    OUTPUT_TASK_PRIORITY,
+    nullptr,
+    OUTPUT_TASK_CORE);
+}
+
+/// @brief Resizes the frame buffers for a new strip length.
+/// @param len The number of LEDs on the strip.
+/// @returns False if the buffers could not be allocated. The
+/// output then stays dark until a resize succeeds.
+///
+/// Waits for the output task to finish the frame it is sending.
+/// When the strip gets shorter, the LEDs past the new end are
+/// turned off first, as they will no longer be sent.
+bool resize_output(uint16_t len){
+
+  xSemaphoreTake(frames_lock, portMAX_DELAY);
+
+  if (exchange.sent && exchange.sent_len > len) {
+    memset(exchange.sent, 0, sizeof(CRGB) * exchange.sent_len);
+    send_frame(exchange.sent_len);
+  }
+
+  free(frames);
+  frames = (CRGB *) calloc(FRAME_EXCHANGE_BUFFERS * len, sizeof(CRGB));
+  frame_capacity = (frames) ? len : 0;
+
+  portENTER_CRITICAL(&pending_lock);
+  frame_exchange_init(&exchange, frames, frame_capacity);
+  portEXIT_CRITICAL(&pending_lock);
+
+  xSemaphoreGive(frames_lock);
+  return frames != nullptr;
+}
+
+/// @brief Sets the span of the frame each output channel sends.
+/// @param spans The span of every channel, laid out by split_channels().
+///
+/// Waits for the output task to finish the frame it is sending.
+void set_output_channels(const Channel_Span * spans){
+  xSemaphoreTake(frames_lock, portMAX_DELAY);
+  memcpy(channel_spans, spans, sizeof(channel_spans));
+  xSemaphoreGive(frames_lock);
+}
+
+/// @brief Hands a newly rendered frame to the output task.
+/// @param leds The new frame.
+/// @param len  The number of LEDs in the frame, up to the strip length.
+///
+/// Never waits on the output task. The frame is copied through
+/// the pixel layout map, so leds can be changed once this returns.
+void show_frame(const CRGB * leds, uint16_t len){
+
+  len = min(len, frame_capacity);
+  if (!len) return;
+
+  layout_apply(exchange.back, leds, len);
+
+  portENTER_CRITICAL(&pending_lock);
+  frame_publish(&exchange, len, millis());
+  portEXIT_CRITICAL(&pending_lock);
+
+  output_stats.rendered++;
+}
+
+/// @brief Returns the counts of frames sent and skipped.
+const Output_Stats * get_output_stats(){
+  return &output_stats;
+}
@@ -0,0 +1,50 @@
+/**@file
+ *
+ * This file contains function headers for output.cpp
+ * along with the output statistics it keeps.
+ *
+**/
+
+#ifndef OUTPUT_H
+#define OUTPUT_H
+
+#include <FastLED.h>
+#include "channels.h"
+
+/// The longest time an unchanged frame is held before it is
+/// sent again anyway, in ms. Refreshes LEDs that picked up noise.
+#define OUTPUT_REFRESH_MS 1000
+
+/// The longest time interpolating between two frames can take,
+/// in ms. Stops a pause in the loop from stretching out a fade.
+#define OUTPUT_MAX_INTERVAL 200
+
+/// The core the output task runs on. It mostly sleeps on the
+/// LED transfer, so it shares the core with the render worker.
+#define OUTPUT_TASK_CORE 0
+
+/// The output task outranks the render worker, so frames go
+/// out at a steady rate.
+#define OUTPUT_TASK_PRIORITY 2
+
+/// Stack size of the output task, in bytes.
+#define OUTPUT_TASK_STACK 4096
+
+/// @brief Counts and timings of the frames sent to the strip.
+typedef struct{
+
+  uint32_t rendered = 0;  /// Frames handed over by the main loop.
+  uint32_t shown = 0;     /// Frames sent to the LED strip, including interpolated ones.
+  uint32_t skipped = 0;   /// Frames skipped because nothing changed.
+  uint32_t last_show = 0; /// The time the last frame was sent, in ms.
+  uint32_t send_us = 0;   /// How long the last frame took to send, in us.
+
+} Output_Stats;
+
+void setup_output();
+bool resize_output(uint16_t len);
+void set_output_channels(const Channel_Span * spans);
+void show_frame(const CRGB * leds, uint16_t len);
+const Output_Stats * get_output_stats();
+
+#endif
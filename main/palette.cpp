@@ -0,0 +1,79 @@
+/** @file
+  *
+  * This file's functions expand the gradient palettes in
+  * palettes.h into lookup tables, and fill the table of fully
+  * saturated hues.
+  *
+  * Tables are expanded on the main loop only. Patterns rendering
+  * on either core read them, but never build them.
+  *
+*/
+
+#include <FastLED.h>
+#include <stdlib.h>
+#include <new>
+#include "nanolux_types.h"
+#include "palettes.h"
+#include "palette.h"
+
+/// The gradient behind every palette, in the order they are numbered.
+static const TProgmemRGBGradientPalettePtr gradients[NUM_PALETTES] = {
+  GMT_hot_gp,
+  hue_gp,
+  Colours_Are_Evil_gp,
+  nrwc_gp,
+};
+
+/// Every expanded palette, or nullptr if it was never selected.
+static CRGBPalette256 * luts[NUM_PALETTES];
+
+/// The default palette's table. It is the fallback for every other
+/// palette, so it is kept off the heap and can never be missing.
+static CRGBPalette256 hot_lut;
+
+/// Every hue at full saturation and value.
+CRGB hue_colors[256];
+
+/// @brief Expands the default palette and the hue table, so both
+/// are always ready.
+void setup_palettes(){
+  prepare_palette(PALETTE_HOT);
+
+  for (int hue = 0; hue < 256; hue++)
+    hsv2rgb_rainbow(CHSV(hue, 255, 255), hue_colors[hue]);
+}
+
+/// @brief Expands a palette into its lookup table, if it was not already.
+/// @param palette The palette to expand, such as PALETTE_HOT.
+///
+/// Call from the main loop before any pattern using the palette
+/// renders. Each table takes 768 bytes of heap and is kept once
+/// built. The PALETTE_HOT table is static instead.
+void prepare_palette(uint8_t palette){
+
+  if (palette >= NUM_PALETTES || luts[palette]) return;
+
+  if (palette == PALETTE_HOT) {
+    hot_lut = CRGBPalette256(gradients[PALETTE_HOT]);
+    luts[PALETTE_HOT] = &hot_lut;
+    return;
+  }
+
+  void * mem = malloc(sizeof(CRGBPalette256));
+  if (!mem) return;
+
+  luts[palette] = new (mem) CRGBPalette256(gradients[palette]);
+}
+
+/// @brief Returns a palette's lookup table, with one color per index.
+/// @param palette The palette to look up, such as PALETTE_HOT.
+///
+/// Palettes that were never prepared, or that did not fit in the
+/// heap, fall back to PALETTE_HOT.
+const CRGB * palette_lut(uint8_t palette){
+
+  if (palette >= NUM_PALETTES || !luts[palette])
+    return hot_lut.entries;
+
+  return luts[palette]->entries;
+}
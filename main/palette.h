@@ -0,0 +1,74 @@
+/**@file
+ *
+ * This file contains function headers for palette.cpp.
+ *
+ * Every palette a pattern can pick is stored as a gradient and
+ * expanded into a 256 color lookup table the first time it is
+ * selected. After that, looking up a color is a single load.
+ *
+ * Fully saturated rainbow hues get the same treatment, since
+ * most position-hued patterns convert a color for every pixel.
+ *
+**/
+
+#ifndef PALETTE_H
+#define PALETTE_H
+
+#include <FastLED.h>
+
+void setup_palettes();
+void prepare_palette(uint8_t palette);
+const CRGB * palette_lut(uint8_t palette);
+
+/// Every hue at full saturation and value, filled by setup_palettes().
+extern CRGB hue_colors[256];
+
+/// @brief Converts a fully saturated hue to RGB through the hue table.
+/// @param hue   The hue to convert.
+/// @param value The brightness of the color.
+/// @returns The same color as hsv2rgb_rainbow(CHSV(hue, 255, value)).
+inline CRGB hue_color(uint8_t hue, uint8_t value = 255){
+  CRGB color = hue_colors[hue];
+  if (value != 255) color.nscale8(scale8_video(value, value));
+  return color;
+}
+
+/// Steps through hues spread evenly along a segment without
+/// dividing for every pixel.
+typedef struct{
+
+  uint8_t hue = 0; /// The hue of the next pixel.
+  uint8_t step = 0; /// The whole hues between two pixels.
+  uint16_t rem = 0; /// The hues left over between two pixels, in 1/len.
+  uint16_t err = 0; /// The left over hues built up so far, in 1/len.
+  uint16_t len = 1; /// The number of pixels in the segment.
+
+} Hue_Ramp;
+
+/// @brief Starts a ramp whose hue at pixel i is start + i * span / len.
+/// @param start The hue of the first pixel.
+/// @param span  The hues covered across the whole segment.
+/// @param len   The number of pixels in the segment.
+inline Hue_Ramp hue_ramp(uint8_t start, uint8_t span, uint16_t len){
+  Hue_Ramp ramp;
+  if (!len) len = 1;
+  ramp.hue = start;
+  ramp.step = span / len;
+  ramp.rem = span % len;
+  ramp.len = len;
+  return ramp;
+}
+
+/// @brief Returns the hue of the next pixel along a ramp.
+inline uint8_t hue_ramp_next(Hue_Ramp * ramp){
+  uint8_t hue = ramp->hue;
+  ramp->hue += ramp->step;
+  ramp->err += ramp->rem;
+  if (ramp->err >= ramp->len) {
+    ramp->err -= ramp->len;
+    ramp->hue++;
+  }
+  return hue;
+}
+
+#endif
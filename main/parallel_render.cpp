@@ -0,0 +1,160 @@
+/** @file
+  *
+  * This file's functions run independent render jobs on both
+  * cores at once.
+  *
+  * Jobs with even indices run on the calling core, and jobs with
+  * odd indices run on the worker. parallel_for() returns once both
+  * halves are done, so the caller can composite the results.
+  *
+  * Jobs must not write to anything another job reads or writes.
+  * Patterns satisfy this as long as they only touch their own
+  * Strip_Buffer and read shared analysis results.
+  *
+*/
+
+#include "parallel_render.h"
+
+/// The job currently being dispatched.
+static Render_Job current_job = nullptr;
+
+/// The context of the job currently being dispatched.
+static void * current_ctx = nullptr;
+
+/// The number of jobs currently being dispatched.
+static int current_count = 0;
+
+/// @brief Runs every other job, starting from first.
+/// @param first The index of the first job to run.
+static void run_jobs(int first){
+  for(int i = first; i < current_count; i += 2)
+    current_job(i, current_ctx);
+}
+
+#ifdef ARDUINO
+
+#include <Arduino.h>
+
+/// The worker task, or nullptr if it has not been started.
+static TaskHandle_t worker = nullptr;
+
+/// Given to the worker when a dispatch starts.
+static SemaphoreHandle_t job_ready;
+
+/// Given back by the worker when its half of a dispatch is done.
+static SemaphoreHandle_t job_done;
+
+/// @brief Waits for dispatches and runs the odd jobs of each.
+static void worker_loop(void * arg){
+  for(;;){
+    xSemaphoreTake(job_ready, portMAX_DELAY);
+    run_jobs(1);
+    xSemaphoreGive(job_done);
+  }
+}
+
+/// @brief Starts the render worker task on RENDER_WORKER_CORE.
+void setup_parallel_render(){
+  job_ready = xSemaphoreCreateBinary();
+  job_done = xSemaphoreCreateBinary();
+
+  xTaskCreatePinnedToCore(
+    worker_loop,
+    "render",
+    RENDER_WORKER_STACK,
+    nullptr,
+    1,
+    &worker,
+    RENDER_WORKER_CORE);
+}
+
+/// @brief Runs count jobs split across both cores.
+/// @param job    The function to run for every index.
+/// @param ctx    Passed to every call of job.
+/// @param count  The number of jobs to run.
+void parallel_for(Render_Job job, void * ctx, int count){
+
+  current_job = job;
+  current_ctx = ctx;
+  current_count = count;
+
+  // A single job gains nothing from the handoff.
+  if(count < 2 || !worker){
+    run_jobs(0);
+    run_jobs(1);
+    return;
+  }
+
+  xSemaphoreGive(job_ready);
+  run_jobs(0);
+  xSemaphoreTake(job_done, portMAX_DELAY);
+}
+
+#else
+
+// Host builds run the same dispatch on a std::thread worker.
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+
+static std::thread * worker = nullptr;
+
+// Never destroyed, as the detached worker waits on them until the
+// process exits.
+static std::mutex & lock = *new std::mutex;
+static std::condition_variable & changed = *new std::condition_variable;
+static bool ready = false;
+static bool done = false;
+
+/// @brief Waits for dispatches and runs the odd jobs of each.
+static void worker_loop(){
+  for(;;){
+    std::unique_lock<std::mutex> guard(lock);
+    changed.wait(guard, []{ return ready; });
+    ready = false;
+    guard.unlock();
+
+    run_jobs(1);
+
+    guard.lock();
+    done = true;
+    changed.notify_all();
+  }
+}
+
+/// @brief Starts the render worker thread.
+void setup_parallel_render(){
+  worker = new std::thread(worker_loop);
+  worker->detach();
+}
+
+/// @brief Runs count jobs split across two threads.
+/// @param job    The function to run for every index.
+/// @param ctx    Passed to every call of job.
+/// @param count  The number of jobs to run.
+void parallel_for(Render_Job job, void * ctx, int count){
+
+  current_job = job;
+  current_ctx = ctx;
+  current_count = count;
+
+  if(count < 2 || !worker){
+    run_jobs(0);
+    run_jobs(1);
+    return;
+  }
+
+  {
+    std::lock_guard<std::mutex> guard(lock);
+    done = false;
+    ready = true;
+  }
+  changed.notify_all();
+
+  run_jobs(0);
+
+  std::unique_lock<std::mutex> guard(lock);
+  changed.wait(guard, []{ return done; });
+}
+
+#endif
@@ -0,0 +1,29 @@
+/**@file
+ *
+ * This file contains function headers for parallel_render.cpp.
+ *
+ * The parallel renderer splits a set of independent jobs, such
+ * as the segments of a split strip, between the calling core
+ * and a worker task on the other core.
+ *
+**/
+
+#ifndef PARALLEL_RENDER_H
+#define PARALLEL_RENDER_H
+
+/// The core the render worker task runs on. The Arduino loop
+/// runs on core 1.
+#define RENDER_WORKER_CORE 0
+
+/// Stack size of the render worker task, in bytes.
+#define RENDER_WORKER_STACK 8192
+
+/// @brief A job run by parallel_for().
+/// @param index  The index of the job, from 0 to count - 1.
+/// @param ctx    The context pointer passed to parallel_for().
+typedef void (*Render_Job)(int index, void * ctx);
+
+void setup_parallel_render();
+void parallel_for(Render_Job job, void * ctx, int count);
+
+#endif
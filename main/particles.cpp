@@ -0,0 +1,103 @@
+/** @file
+  *
+  * This file's functions move, fade and draw particle pools.
+  *
+  * Pools live in pattern state, so they are only ever touched
+  * by the pattern that owns them.
+  *
+*/
+
+#include <FastLED.h>
+#include "particles.h"
+#include "palette.h"
+
+/// @brief Copies the last live particle into a slot, freeing the last.
+/// @param pool The pool to remove from.
+/// @param i    The slot of the particle to remove.
+static void remove_particle(Particle_Pool * pool, int i){
+  int last = --pool->count;
+
+  pool->pos[i] = pool->pos[last];
+  pool->vel[i] = pool->vel[last];
+  pool->hue[i] = pool->hue[last];
+  pool->sat[i] = pool->sat[last];
+  pool->value[i] = pool->value[last];
+  pool->life[i] = pool->life[last];
+}
+
+/// @brief Adds a particle to a pool.
+/// @param pool  The pool to add to.
+/// @param pos   Where the particle starts, in 1/16 pixels.
+/// @param vel   How far the particle moves every frame, in 1/16 pixels.
+/// @param hue   The particle's hue.
+/// @param sat   The particle's saturation.
+/// @param value The particle's brightness.
+///
+/// When the pool is full, the particle replaces the one with the
+/// least life left.
+void particles_spawn(Particle_Pool * pool, int16_t pos, int16_t vel,
+                     uint8_t hue, uint8_t sat, uint8_t value){
+
+  int slot = pool->count;
+
+  if (slot >= PARTICLE_LIMIT) {
+    slot = 0;
+    for (int i = 1; i < pool->count; i++)
+      if (pool->life[i] < pool->life[slot]) slot = i;
+  } else {
+    pool->count++;
+  }
+
+  pool->pos[slot] = pos;
+  pool->vel[slot] = vel;
+  pool->hue[slot] = hue;
+  pool->sat[slot] = sat;
+  pool->value[slot] = value;
+  pool->life[slot] = 255;
+}
+
+/// @brief Moves and fades every live particle by one frame.
+/// @param pool The pool to update.
+/// @param len  The number of pixels the particles can be on.
+/// @param fade How much life each particle loses, out of 255.
+///
+/// Particles that leave the strip or run out of life are removed.
+void particles_update(Particle_Pool * pool, int len, uint8_t fade){
+
+  int32_t end = (int32_t) len << PARTICLE_FRAC_BITS;
+
+  for (int i = 0; i < pool->count;) {
+    int32_t pos = pool->pos[i] + pool->vel[i];
+    uint8_t life = scale8(pool->life[i], 255 - fade);
+
+    if (!life || pos < 0 || pos >= end) {
+      remove_particle(pool, i);
+      continue;
+    }
+
+    pool->pos[i] = pos;
+    pool->life[i] = life;
+    i++;
+  }
+}
+
+/// @brief Adds every live particle onto an LED buffer.
+/// @param pool The pool to draw.
+/// @param leds The buffer to draw onto.
+/// @param len  The number of pixels in the buffer.
+///
+/// Particles on the same pixel add up, saturating at full
+/// brightness.
+void particles_draw(const Particle_Pool * pool, CRGB * leds, int len){
+
+  for (int i = 0; i < pool->count; i++) {
+    int x = pool->pos[i] >> PARTICLE_FRAC_BITS;
+    if (x < 0 || x >= len) continue;
+
+    CRGB color = (pool->sat[i] == 255)
+      ? hue_color(pool->hue[i], pool->value[i])
+      : CRGB(CHSV(pool->hue[i], pool->sat[i], pool->value[i]));
+
+    leds[x] += color.nscale8(pool->life[i]);
+  }
+}
@@ -0,0 +1,50 @@
+/**@file
+ *
+ * This file contains the particle pool used by sparkle and
+ * raindrop patterns, along with function headers for
+ * particles.cpp.
+ *
+ * Every field of the pool is its own array, and live particles
+ * are packed at the front. Updating and drawing only touch the
+ * live particles, so their cost follows the particle count
+ * instead of the strip length.
+ *
+**/
+
+#ifndef PARTICLES_H
+#define PARTICLES_H
+
+#include <FastLED.h>
+#include <stdint.h>
+
+/// The most particles one pool can hold.
+#define PARTICLE_LIMIT 32
+
+/// The number of fractional bits in particle positions and velocities.
+#define PARTICLE_FRAC_BITS 4
+
+/// Converts a whole pixel index into a particle position.
+#define PARTICLE_PIXEL(x) ((int16_t) ((x) << PARTICLE_FRAC_BITS))
+
+/// @brief A fixed-capacity pool of particles.
+///
+/// Particles only move and fade. Patterns spawn them and decide
+/// what happens to the rest of the strip.
+typedef struct{
+
+  int16_t pos[PARTICLE_LIMIT] = {0};  /// Where each particle is, in 1/16 pixels.
+  int16_t vel[PARTICLE_LIMIT] = {0};  /// How far each particle moves every frame, in 1/16 pixels.
+  uint8_t hue[PARTICLE_LIMIT] = {0};  /// The hue of each particle.
+  uint8_t sat[PARTICLE_LIMIT] = {0};  /// The saturation of each particle.
+  uint8_t value[PARTICLE_LIMIT] = {0}; /// The brightness each particle was spawned with.
+  uint8_t life[PARTICLE_LIMIT] = {0}; /// How much of that brightness is left, out of 255.
+  uint8_t count = 0; /// The number of live particles, packed at the front.
+
+} Particle_Pool;
+
+void particles_spawn(Particle_Pool * pool, int16_t pos, int16_t vel,
+                     uint8_t hue, uint8_t sat, uint8_t value);
+void particles_update(Particle_Pool * pool, int len, uint8_t fade);
+void particles_draw(const Particle_Pool * pool, CRGB * leds, int len);
+
+#endif
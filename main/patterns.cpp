@@ -15,7 +15,12 @@
 #include "storage.h"
 #include "core_analysis.h"
 #include "ext_analysis.h"
-#include "palettes.h"
+#include "filterbank.h"
+#include "tempo.h"
+#include "layout.h"
+#include "palette.h"
+#include "noise_field.h"
+#include "blur.h"
 
 extern unsigned long microseconds;
 extern double vReal[SAMPLES];      // Sampling buffers
@@ -26,13 +31,7 @@ extern bool button_pressed;
 extern SimplePatternList gPatterns;
 extern int NUM_PATTERNS;
 extern SimplePatternList gPatterns_layer;
-extern double peak;                       //  peak frequency
-extern uint8_t fHue;                      // hue value based on peak frequency
-extern double volume;                     //  NOOOOTEEEE:  static?? 
-extern uint8_t vbrightness;
 extern double maxDelt;                    // Frequency with the biggest change in amp.
-extern int advanced_size;
-CRGBPalette16 gPal = GMT_hot_gp; //store all palettes in array
 bool gReverseDirection = false;
 
 extern Config_Data config; // Currently loaded config
@@ -40,14 +39,23 @@ extern Pattern_Data params;
 
 extern uint8_t manual_pattern_idx;
 extern bool manual_control_enabled;
-extern double fbs[5]; 
 
 /// Global formant array, used for accessing.
 extern double formants[3];
 
-// get frequency hue
-void getFhue(uint8_t min_hue, uint8_t max_hue){
-    fHue = remap(
+/// Global log-spaced filterbank, one value per band.
+extern double log_bands[FILTERBANK_MAX_BANDS];
+
+/// Global vowel detected in the current frame.
+extern VowelSounds current_vowel;
+
+/// @brief Calculates a hue from a peak frequency.
+/// @param peak     The peak frequency, in Hz.
+/// @param min_hue  The hue at MIN_FREQUENCY.
+/// @param max_hue  The hue at MAX_FREQUENCY.
+/// @returns The hue the peak frequency maps to.
+uint8_t getFhue(double peak, uint8_t min_hue, uint8_t max_hue){
+    return remap(
     log(peak) / log(2),
     log(MIN_FREQUENCY) / log(2),
     log(MAX_FREQUENCY) / log(2),
@@ -56,9 +64,11 @@ void getFhue(uint8_t min_hue, uint8_t max_hue){
     // 10, 240);
 }
 
-/// get vol brightness
-void getVbrightness(){
-    vbrightness = remap(
+/// @brief Calculates a brightness from a volume.
+/// @param volume The volume to map to a brightness.
+/// @returns The brightness the volume maps to.
+uint8_t getVbrightness(double volume){
+    return remap(
     volume,
     MIN_VOLUME,
     MAX_VOLUME,
@@ -81,7 +91,7 @@ void clearLEDSegment(Strip_Buffer * buf, int len){
     buf->leds[i] = CRGB(0,0,0);
 }
 
-void blank(Strip_Buffer * buf, int len, Pattern_Data* params){
+void blank(Strip_Buffer * buf, int len, Pattern_Data* params, Audio_Data* audio){
   clearLEDSegment(buf, len);
 }
 
@@ -93,37 +103,64 @@ void setColorHSV(CRGB* leds, byte h, byte s, byte v, int len) {
 }
 
 
+/// @brief Leaves a fading pixel behind where a pix_freq() marker was.
+/// @param trail The pool holding the trail.
+/// @param from  Where the marker was last frame.
+/// @param to    Where the marker is now.
+/// @param hue   The marker's hue last frame.
+/// @param sat   The marker's saturation.
+/// @param len   The length of LEDs to process.
+static void leave_trail(Particle_Pool * trail, int from, int to, uint8_t hue, uint8_t sat, int len){
+  if (from != to && from >= 0 && from < len)
+    particles_spawn(trail, PARTICLE_PIXEL(from), 0, hue, sat, 255);
+}
+
 /// @brief Based on a sufficient volume, a pixel will float to some position on the light strip 
 ///        and fall down (vol_show adds another threshold)
 /// @param buf Pointer to the Strip_Buffer structure, holds LED buffer and history variables.
 /// @param len The length of LEDs to process
 /// @param params Pointer to Pattern_Data structure containing configuration options.
-void pix_freq(Strip_Buffer * buf, int len, Pattern_Data* params) {
+/// @param audio Pointer to Audio_Data structure holding this frame's audio features.
+void pix_freq(Strip_Buffer * buf, int len, Pattern_Data* params, Audio_Data* audio) {
     //switch(params->config){
       //case 0:
       //default:
     //getFhue();
-    fadeToBlackBy(buf->leds, len, 50);
-    if (volume > 200) {
-      buf->pix_pos = map(peak, MIN_FREQUENCY, MAX_FREQUENCY, 0, len-1);
-      buf->tempHue = fHue;
+    Pix_Freq_State * state = (Pix_Freq_State *) buf->state;
+    int last_pix = state->pix_pos;
+    int last_vol = state->vol_pos;
+    uint8_t last_hue = state->tempHue;
+
+    if (audio->volume > 200) {
+      state->pix_pos = map(audio->peak, MIN_FREQUENCY, MAX_FREQUENCY, 0, len-1);
+      state->tempHue = audio->fHue;
     }
     else {
-      buf->pix_pos--;
-      buf->tempHue--;
-      buf->vol_pos--;
+      state->pix_pos--;
+      state->tempHue--;
+      state->vol_pos--;
     }
     if (VOL_SHOW) {
-      if (volume > 100) {
-        buf->vol_pos = map(volume, MIN_VOLUME, MAX_VOLUME, 0, len-1);
-        buf->tempHue = fHue;
+      if (audio->volume > 100) {
+        state->vol_pos = map(audio->volume, MIN_VOLUME, MAX_VOLUME, 0, len-1);
+        state->tempHue = audio->fHue;
       } else {
-        buf->vol_pos--;
+        state->vol_pos--;
       }
-
-      buf->leds[buf->vol_pos] = buf->vol_pos < len ? CRGB(255, 255, 255):CRGB(0, 0, 0);
+      leave_trail(&state->trail, last_vol, state->vol_pos, 0, 0, len);
     }
-    buf->leds[buf->pix_pos] = buf->pix_pos < len ? CHSV(buf->tempHue, 255, 255):CRGB(0, 0, 0);
+    leave_trail(&state->trail, last_pix, state->pix_pos, last_hue, 255, len);
+
+    // The markers keep falling once they pass the start of the
+    // strip, but are only drawn while they are on it.
+    clearLEDSegment(buf, len);
+    particles_update(&state->trail, len, 50);
+    particles_draw(&state->trail, buf->leds, len);
+
+    if (VOL_SHOW && state->vol_pos >= 0 && state->vol_pos < len)
+      buf->leds[state->vol_pos] = CRGB(255, 255, 255);
+    if (state->pix_pos >= 0 && state->pix_pos < len)
+      buf->leds[state->pix_pos] = hue_color(state->tempHue);
 }
 
 /// @brief Confetti effect using frequency and brightness.
@@ -131,16 +168,21 @@ void pix_freq(Strip_Buffer * buf, int len, Pattern_Data* params) {
 /// @param buf Pointer to the Strip_Buffer structure, holds LED buffer and history variables.
 /// @param len The length of LEDs to process
 /// @param params Pointer to Pattern_Data structure containing configuration options.
-void confetti(Strip_Buffer * buf, int len, Pattern_Data* params){
+/// @param audio Pointer to Audio_Data structure holding this frame's audio features.
+void confetti(Strip_Buffer * buf, int len, Pattern_Data* params, Audio_Data* audio){
   // colored speckles based on frequency that blink in and fade smoothly
-  fadeToBlackBy(buf->leds, len, 20);
-  int pos = random16(len);
+  Particle_Pool * pool = (Particle_Pool *) buf->state;
+  int16_t pos = PARTICLE_PIXEL(random16(len));
   switch(params->config){
       case 0:
       default:
-      buf->leds[pos] += CHSV( fHue + random8(10), 255, vbrightness);
-      buf->leds[pos] += CHSV( fHue + random8(10), 255, vbrightness);
+      particles_spawn(pool, pos, 0, audio->fHue + random8(10), 255, audio->vbrightness);
+      particles_spawn(pool, pos, 0, audio->fHue + random8(10), 255, audio->vbrightness);
   }
+
+  clearLEDSegment(buf, len);
+  particles_update(pool, len, 20);
+  particles_draw(pool, buf->leds, len);
 }
 
 /// @brief  Outputs a steady moving stream of lights where each pixel correlates to a previous fHue value.
@@ -149,12 +191,14 @@ void confetti(Strip_Buffer * buf, int len, Pattern_Data* params){
 /// @param buf Pointer to the Strip_Buffer structure, holds LED buffer and history variables.
 /// @param len The length of LEDs to process
 /// @param params Pointer to Pattern_Data structure containing configuration options.
-void hue_trail(Strip_Buffer* buf, int len, Pattern_Data* params) {
-    switch (params->config) {
+/// @param audio Pointer to Audio_Data structure holding this frame's audio features.
+template <uint8_t CONFIG>
+void hue_trail(Strip_Buffer* buf, int len, Pattern_Data* params, Audio_Data* audio) {
+    switch (CONFIG) {
         case 0: // freq_hue_trail (also default case)
         default: // Default case set to execute the freq_hue_trail pattern
-            buf->leds[0] = CHSV(fHue, 255, vbrightness);
-            buf->leds[1] = CHSV(fHue, 255, vbrightness);
+            buf->leds[0] = hue_color(audio->fHue, audio->vbrightness);
+            buf->leds[1] = buf->leds[0];
             for (int i = len - 1; i > 1; i -= 2) {
                 buf->leds[i] = buf->leds[i - 2];
                 buf->leds[i - 1] = buf->leds[i - 2];
@@ -163,8 +207,8 @@ void hue_trail(Strip_Buffer* buf, int len, Pattern_Data* params) {
 
         case 1: // blur
             {
-            buf->leds[0] = CHSV(fHue, 255, vbrightness);
-            buf->leds[1] = CHSV(fHue, 255, vbrightness);
+            buf->leds[0] = hue_color(audio->fHue, audio->vbrightness);
+            buf->leds[1] = buf->leds[0];
             for (int i = len - 1; i > 1; i -= 2) {
                 buf->leds[i] = buf->leds[i - 2];
                 buf->leds[i - 1] = buf->leds[i - 2];
@@ -175,10 +219,10 @@ void hue_trail(Strip_Buffer* buf, int len, Pattern_Data* params) {
         case 2: //sin_hue
         {
         //Create sin beat
-        uint16_t sinBeat0  = beatsin16(12, 0, len-1, 0, 0);
+        uint16_t sinBeat0  = tempo_beatsin16(12, 0, len-1, 0, 0);
         
         //Given the sinBeat and fHue, color the LEDS and fade
-        buf->leds[sinBeat0]  = CHSV(fHue, 255, MAX_BRIGHTNESS);
+        buf->leds[sinBeat0]  = hue_color(audio->fHue, MAX_BRIGHTNESS);
         fadeToBlackBy(buf->leds, len, 5);
         break;
       }
@@ -186,6 +230,10 @@ void hue_trail(Strip_Buffer* buf, int len, Pattern_Data* params) {
   }
 }
 
+/// The handler for each config of hue_trail(), in config order.
+static const Pattern_Handler hue_trail_handlers[] = { hue_trail<0>, hue_trail<1>, hue_trail<2> };
+const Pattern_Configs hue_trail_configs = { hue_trail_handlers, ARRAY_SIZE(hue_trail_handlers) };
+
 /// @brief  Fills the light strip with a nice ambient mess of colors that shift slowly over time. 
 ///         This function is similar to grovvy noise except the scale and hue_shift values are quiote different.
 ///         Hue Octave Config remaps the volume to the range of hues present on strip.
@@ -194,7 +242,9 @@ void hue_trail(Strip_Buffer* buf, int len, Pattern_Data* params) {
 /// @param buf Pointer to the Strip_Buffer structure, holds LED buffer and history variables.
 /// @param len The length of LEDs to process
 /// @param params Pointer to Pattern_Data structure containing configuration options.
-void saturated(Strip_Buffer* buf, int len, Pattern_Data* params){
+/// @param audio Pointer to Audio_Data structure holding this frame's audio features.
+template <uint8_t CONFIG>
+void saturated(Strip_Buffer* buf, int len, Pattern_Data* params, Audio_Data* audio){
   //Set params for fill_noise16()
   uint8_t octaves = 1;
   uint16_t x = 0;
@@ -204,42 +254,65 @@ void saturated(Strip_Buffer* buf, int len, Pattern_Data* params){
   int hue_scale = 20; 
   uint16_t ntime = millis() / 3;
   uint8_t hue_shift =  50;
-   switch (params->config) {
+   switch (CONFIG) {
         case 0: // Default, no additional values changed
-            fill_noise16 (buf->leds, len, octaves, x, scale, hue_octaves, hue_x, hue_scale, ntime, hue_shift);
+            fill_noise_field(buf->leds, len, octaves, x, scale, hue_octaves, hue_x, hue_scale, ntime, hue_shift);
           break;
         case 1: { // Hue octaves 
-            hue_octaves = remap(volume, MIN_VOLUME, MAX_VOLUME, 1, 10);
-            fill_noise16 (buf->leds, len, octaves, x, scale, hue_octaves, hue_x, hue_scale, ntime, hue_shift);
+            hue_octaves = remap(audio->volume, MIN_VOLUME, MAX_VOLUME, 1, 10);
+            fill_noise_field(buf->leds, len, octaves, x, scale, hue_octaves, hue_x, hue_scale, ntime, hue_shift);
             }
             break;
             
         case 2: {// Hue shift 
-            octaves = remap(volume, MIN_VOLUME, MAX_VOLUME, 50, 100);
-            hue_shift = remap(volume, MIN_VOLUME, MAX_VOLUME, 50, 100);
+            octaves = remap(audio->volume, MIN_VOLUME, MAX_VOLUME, 50, 100);
+            hue_shift = remap(audio->volume, MIN_VOLUME, MAX_VOLUME, 50, 100);
             scale = 230;
             hue_x = 150;
-            fill_noise16 (buf->leds, len, octaves, x, scale, hue_octaves, hue_x, hue_scale, ntime, hue_shift);            }
+            fill_noise_field(buf->leds, len, octaves, x, scale, hue_octaves, hue_x, hue_scale, ntime, hue_shift);            }
             break;
         case 3:{ // Compression
-            hue_x = remap(volume, MIN_VOLUME, MAX_VOLUME, 1, 8);
+            hue_x = remap(audio->volume, MIN_VOLUME, MAX_VOLUME, 1, 8);
             ntime = millis() / 4;
-            fill_noise16 (buf->leds, len, octaves, x, scale, hue_octaves, hue_x, hue_scale, ntime, hue_shift);
+            fill_noise_field(buf->leds, len, octaves, x, scale, hue_octaves, hue_x, hue_scale, ntime, hue_shift);
             }
             break;
-  //Add blur
-  blur1d(buf->leds, len, 80);
+  }
+}
+
+/// The handler for each config of saturated(), in config order.
+static const Pattern_Handler saturated_handlers[] = { saturated<0>, saturated<1>, saturated<2>, saturated<3> };
+const Pattern_Configs saturated_configs = { saturated_handlers, ARRAY_SIZE(saturated_handlers) };
+
+/// @brief Fills a buffer with noise, in 2D when the layout has rows.
+/// @param leds The buffer to fill.
+/// @param len  The number of LEDs in the buffer.
+///
+/// The remaining parameters match fill_noise16(). On a 2D canvas,
+/// the same scales are used for both axes. Otherwise, the noise
+/// field interpolates between sparse samples.
+static void fill_canvas_noise16(CRGB * leds, int len, uint8_t octaves, uint16_t x, int scale,
+                                uint8_t hue_octaves, uint16_t hue_x, int hue_scale,
+                                uint16_t ntime, uint8_t hue_shift){
+  int width, height;
+  if (layout_canvas(len, &width, &height)) {
+    fill_2dnoise16(leds, width, height, false, octaves, x, scale, 0, scale, ntime,
+                   hue_octaves, hue_x, hue_scale, 0, hue_scale, ntime, false, hue_shift);
+  } else {
+    fill_noise_field(leds, len, octaves, x, scale, hue_octaves, hue_x, hue_scale, ntime, hue_shift);
   }
 }
 
 /// @brief   A cool fluctuating pattern that changes color in waves of greens, yellows, purples and blue. 
 ///       This function is similar to saturated_noise but the values of scale and hue_shift are 100 and 5 respectively. 
-///       This is a moving pattern but it does not change based on and volume or frequency changes. Uses fill_noise16() and blur.
+///       This is a moving pattern but it does not change based on and volume or frequency changes. Uses the noise field and blur,
+///       or fill_2dnoise16() on a 2D layout.
 ///       Hue Shift Change configuration remaps volume variable as hue_shift.
 /// @param buf Pointer to the Strip_Buffer structure, holds LED buffer and history variables.
 /// @param len The length of LEDs to process
 /// @param params Pointer to Pattern_Data structure containing configuration options.
-void groovy(Strip_Buffer* buf, int len, Pattern_Data* params) {
+/// @param audio Pointer to Audio_Data structure holding this frame's audio features.
+void groovy(Strip_Buffer* buf, int len, Pattern_Data* params, Audio_Data* audio) {
   uint8_t octaves = 1;
   uint16_t x = 0;
   int scale = 100;
@@ -254,21 +327,21 @@ void groovy(Strip_Buffer* buf, int len, Pattern_Data* params) {
         case 0: // groovy_noise (also default case)
         default:
             {
-                fill_noise16(buf->leds, len, octaves, x, scale, hue_octaves, hue_x, hue_scale, ntime, hue_shift);
+                fill_canvas_noise16(buf->leds, len, octaves, x, scale, hue_octaves, hue_x, hue_scale, ntime, hue_shift);
             }
             break;
 
         case 1: // Hue Shift Change
             {
-                int shiftFromVolume = remap(volume, MIN_VOLUME, MAX_VOLUME, 5, 220);
-                int xFromVolume = remap(volume, MIN_VOLUME, MAX_VOLUME, 1, 2);
+                int shiftFromVolume = remap(audio->volume, MIN_VOLUME, MAX_VOLUME, 5, 220);
+                int xFromVolume = remap(audio->volume, MIN_VOLUME, MAX_VOLUME, 1, 2);
                 x = 0;
                 hue_octaves = 1;
                 hue_x = xFromVolume;
                 hue_scale = 20;
                 hue_shift =  shiftFromVolume;
 
-                fill_noise16(buf->leds, len, octaves, x, scale, hue_octaves, hue_x, hue_scale, ntime, hue_shift);
+                fill_canvas_noise16(buf->leds, len, octaves, x, scale, hue_octaves, hue_x, hue_scale, ntime, hue_shift);
             }
             break;
     }
@@ -282,12 +355,14 @@ void groovy(Strip_Buffer* buf, int len, Pattern_Data* params) {
 /// @param buf Pointer to the Strip_Buffer structure, holds LED buffer and history variables.
 /// @param len The length of LEDs to process
 /// @param params Pointer to Pattern_Data structure containing configuration options.
-void talking(Strip_Buffer *buf, int len, Pattern_Data *params) {
+/// @param audio Pointer to Audio_Data structure holding this frame's audio features.
+template <uint8_t CONFIG>
+void talking(Strip_Buffer *buf, int len, Pattern_Data* params, Audio_Data* audio) {
   // Common variables
   int offsetFromVolume;
   int midpoint = len / 2;
 
-  switch (params->config) {
+  switch (CONFIG) {
     case 1: { // Formants
       double f0Hue = remap(formants[0], MIN_FREQUENCY, MAX_FREQUENCY, 0, 255);
       double f1Hue = remap(formants[1], MIN_FREQUENCY, MAX_FREQUENCY, 0, 255);
@@ -295,7 +370,7 @@ void talking(Strip_Buffer *buf, int len, Pattern_Data *params) {
       double f1 = remap(formants[1], MIN_FREQUENCY, MAX_FREQUENCY, 0, 255);
       double f2 = remap(formants[2], MIN_FREQUENCY, MAX_FREQUENCY, 0, 255);
 
-      offsetFromVolume = remap(volume, MIN_VOLUME, MAX_VOLUME, 1, 30);
+      offsetFromVolume = remap(audio->volume, MIN_VOLUME, MAX_VOLUME, 1, 30);
       buf->leds[len / 2] = CRGB(f0, f1, f2);
       buf->leds[len / 2 - offsetFromVolume] = CHSV(f0Hue, 255, MAX_BRIGHTNESS);
       buf->leds[len / 2 + offsetFromVolume] = CHSV(f0Hue, 255, MAX_BRIGHTNESS);
@@ -303,34 +378,38 @@ void talking(Strip_Buffer *buf, int len, Pattern_Data *params) {
     } 
 
     case 2: { // Moving
-      offsetFromVolume = remap(volume, MIN_VOLUME, MAX_VOLUME, 0, 12500);
+      offsetFromVolume = remap(audio->volume, MIN_VOLUME, MAX_VOLUME, 0, 12500);
 
-      uint16_t sinBeat0 = beatsin16(5, 2, len - 3, 0, 250);
-      uint16_t sinBeat1 = beatsin16(5, 2, len - 3, 0, 0 - offsetFromVolume);
-      uint16_t sinBeat2 = beatsin16(5, 2, len - 3, 0, 750 + offsetFromVolume);
+      uint16_t sinBeat0 = tempo_beatsin16(5, 2, len - 3, 0, 250);
+      uint16_t sinBeat1 = tempo_beatsin16(5, 2, len - 3, 0, 0 - offsetFromVolume);
+      uint16_t sinBeat2 = tempo_beatsin16(5, 2, len - 3, 0, 750 + offsetFromVolume);
 
-      buf->leds[sinBeat0] = CHSV(fHue + 100, 255, MAX_BRIGHTNESS);
-      buf->leds[sinBeat1] = CHSV(fHue, 255, MAX_BRIGHTNESS);
-      buf->leds[sinBeat2] = CHSV(fHue, 255, MAX_BRIGHTNESS);
+      buf->leds[sinBeat0] = CHSV(audio->fHue + 100, 255, MAX_BRIGHTNESS);
+      buf->leds[sinBeat1] = CHSV(audio->fHue, 255, MAX_BRIGHTNESS);
+      buf->leds[sinBeat2] = CHSV(audio->fHue, 255, MAX_BRIGHTNESS);
       break;
     } 
 
     default: // Talking Hue
     case 0:
-      offsetFromVolume = remap(volume, MIN_VOLUME, MAX_VOLUME, 1, len/2);
-      buf->leds[midpoint] = CHSV(fHue / 2, 255, MAX_BRIGHTNESS);
-      buf->leds[midpoint - offsetFromVolume] = CHSV(fHue, 255, MAX_BRIGHTNESS);
-      buf->leds[midpoint + offsetFromVolume] = CHSV(fHue, 255, MAX_BRIGHTNESS);
+      offsetFromVolume = remap(audio->volume, MIN_VOLUME, MAX_VOLUME, 1, len/2);
+      buf->leds[midpoint] = CHSV(audio->fHue / 2, 255, MAX_BRIGHTNESS);
+      buf->leds[midpoint - offsetFromVolume] = CHSV(audio->fHue, 255, MAX_BRIGHTNESS);
+      buf->leds[midpoint + offsetFromVolume] = CHSV(audio->fHue, 255, MAX_BRIGHTNESS);
       break;
   }
 
   // Common effects for all modes
   blur1d(buf->leds, len, 80);
   // Adjust fade value based on the pattern
-  int fadeValue = (params->config == 0 || params->config == 2) ? 150 : (params->config == 1) ? 200 : 100;
+  int fadeValue = (CONFIG == 0 || CONFIG == 2) ? 150 : (CONFIG == 1) ? 200 : 100;
   fadeToBlackBy(buf->leds, len, fadeValue);
 }
 
+/// The handler for each config of talking(), in config order.
+static const Pattern_Handler talking_handlers[] = { talking<0>, talking<1>, talking<2> };
+const Pattern_Configs talking_configs = { talking_handlers, ARRAY_SIZE(talking_handlers) };
+
 /// @brief  Creates two light clusters that move according to sine wave motion, but their speed is affected by the volume. 
 ///         One pulls its color from fHue, and the other pulls its color from the formant values.
 ///         Talk configuration combines glitch with talking_moving().
@@ -338,20 +417,22 @@ void talking(Strip_Buffer *buf, int len, Pattern_Data *params) {
 /// @param buf Pointer to the Strip_Buffer structure, holds LED buffer and history variables.
 /// @param len The length of LEDs to process
 /// @param params Pointer to Pattern_Data structure containing configuration options.
-void glitch(Strip_Buffer * buf, int len, Pattern_Data * params ) {
+/// @param audio Pointer to Audio_Data structure holding this frame's audio features.
+template <uint8_t CONFIG>
+void glitch(Strip_Buffer * buf, int len, Pattern_Data* params, Audio_Data* audio) {
     int offsetFromVolume, speedFromVolume;
     uint16_t sinBeat[4]; 
     double f0Hue;
     
-    speedFromVolume = remap(volume, MIN_VOLUME, MAX_VOLUME, 5, params->config == 0 ? 25 : 20); 
-    switch (params->config) {
+    speedFromVolume = remap(audio->volume, MIN_VOLUME, MAX_VOLUME, 5, CONFIG == 0 ? 25 : 20); 
+    switch (CONFIG) {
         case 0:
-            sinBeat[0] = beatsin16(speedFromVolume, 0, len-1, 0, 0);
-            sinBeat[1] = beatsin16(speedFromVolume, 0, len-1, 0, 32767);
+            sinBeat[0] = tempo_beatsin16(speedFromVolume, 0, len-1, 0, 0);
+            sinBeat[1] = tempo_beatsin16(speedFromVolume, 0, len-1, 0, 32767);
 
             f0Hue = remap(formants[0], MIN_FREQUENCY, MAX_FREQUENCY, 0, 255);
 
-            buf->leds[sinBeat[0]]  = CHSV(fHue, 255, MAX_BRIGHTNESS);
+            buf->leds[sinBeat[0]]  = CHSV(audio->fHue, 255, MAX_BRIGHTNESS);
             buf->leds[sinBeat[1]]  = CHSV(f0Hue, 255, MAX_BRIGHTNESS); //can use fHue instead of formants
 
             blur1d(buf->leds, len, 80);
@@ -360,17 +441,17 @@ void glitch(Strip_Buffer * buf, int len, Pattern_Data * params ) {
             break;
         case 1: // glitch_talk
           {
-            offsetFromVolume = remap(volume, MIN_VOLUME, MAX_VOLUME, 0, 20000);
+            offsetFromVolume = remap(audio->volume, MIN_VOLUME, MAX_VOLUME, 0, 20000);
 
             //Create 3 sin beats with the speed and offset(first and last parameters) changing based off variables above
-            uint16_t sinBeat0  = beatsin16(speedFromVolume, 3, len-4, 0, 250);
-            uint16_t sinBeat1  = beatsin16(speedFromVolume, 3, len-4, 0, 0 - offsetFromVolume);
-            uint16_t sinBeat2  = beatsin16(speedFromVolume, 3, len-4, 0, 750 + offsetFromVolume);
+            uint16_t sinBeat0  = tempo_beatsin16(speedFromVolume, 3, len-4, 0, 250);
+            uint16_t sinBeat1  = tempo_beatsin16(speedFromVolume, 3, len-4, 0, 0 - offsetFromVolume);
+            uint16_t sinBeat2  = tempo_beatsin16(speedFromVolume, 3, len-4, 0, 750 + offsetFromVolume);
 
             //Given the sinBeats and fHue, color the LEDS  
-            buf->leds[sinBeat0]  = CHSV(fHue*2, 255, MAX_BRIGHTNESS);
-            buf->leds[sinBeat1]  = CHSV(fHue, 255, MAX_BRIGHTNESS);
-            buf->leds[sinBeat2]  = CHSV(fHue, 255, MAX_BRIGHTNESS);
+            buf->leds[sinBeat0]  = CHSV(audio->fHue*2, 255, MAX_BRIGHTNESS);
+            buf->leds[sinBeat1]  = CHSV(audio->fHue, 255, MAX_BRIGHTNESS);
+            buf->leds[sinBeat2]  = CHSV(audio->fHue, 255, MAX_BRIGHTNESS);
 
             blur1d(buf->leds, len, 80);
             fadeToBlackBy(buf->leds, len, 100); 
@@ -379,19 +460,19 @@ void glitch(Strip_Buffer * buf, int len, Pattern_Data * params ) {
           }
         case 2: // glitch_sections
           {
-            offsetFromVolume = remap(volume, MIN_VOLUME, MAX_VOLUME, 0, 10000);
+            offsetFromVolume = remap(audio->volume, MIN_VOLUME, MAX_VOLUME, 0, 10000);
 
             //Create 4 sin beats with the offset(last parameter) changing based off offsetFromVolume
-            uint16_t sinBeat0  = beatsin16(6, 0, len-1, 0, 0     - offsetFromVolume);
-            uint16_t sinBeat1  = beatsin16(6, 0, len-1, 0, 16384 - offsetFromVolume);
-            uint16_t sinBeat2  = beatsin16(6, 0, len-1, 0, 32767 - offsetFromVolume);
-            uint16_t sinBeat3  = beatsin16(6, 0, len-1, 0, 49151 - offsetFromVolume);
+            uint16_t sinBeat0  = tempo_beatsin16(6, 0, len-1, 0, 0     - offsetFromVolume);
+            uint16_t sinBeat1  = tempo_beatsin16(6, 0, len-1, 0, 16384 - offsetFromVolume);
+            uint16_t sinBeat2  = tempo_beatsin16(6, 0, len-1, 0, 32767 - offsetFromVolume);
+            uint16_t sinBeat3  = tempo_beatsin16(6, 0, len-1, 0, 49151 - offsetFromVolume);
 
             //Given the sinBeats and fHue, color the LEDS
-            buf->leds[sinBeat0]  = CHSV(fHue, 255, MAX_BRIGHTNESS);
-            buf->leds[sinBeat1]  = CHSV(fHue, 255, MAX_BRIGHTNESS);
-            buf->leds[sinBeat2]  = CHSV(fHue, 255, MAX_BRIGHTNESS);
-            buf->leds[sinBeat3]  = CHSV(fHue, 255, MAX_BRIGHTNESS);
+            buf->leds[sinBeat0]  = CHSV(audio->fHue, 255, MAX_BRIGHTNESS);
+            buf->leds[sinBeat1]  = CHSV(audio->fHue, 255, MAX_BRIGHTNESS);
+            buf->leds[sinBeat2]  = CHSV(audio->fHue, 255, MAX_BRIGHTNESS);
+            buf->leds[sinBeat3]  = CHSV(audio->fHue, 255, MAX_BRIGHTNESS);
           
             //Add blur and fade 
             blur1d(buf->leds, len, 80);
@@ -401,6 +482,10 @@ void glitch(Strip_Buffer * buf, int len, Pattern_Data * params ) {
     }
 }
 
+/// The handler for each config of glitch(), in config order.
+static const Pattern_Handler glitch_handlers[] = { glitch<0>, glitch<1>, glitch<2> };
+const Pattern_Configs glitch_configs = { glitch_handlers, ARRAY_SIZE(glitch_handlers) };
+
 /// @brief  Basic band config : Uses the band_split_bounce() function to generate a five band split, and maps that split to the light strip. The strip is broken into five chunks of different colors, 
 ///         where the volume of each band determines how much of each section of the LED strip is lit.
 ///         Advanced bands config : he strip is broken into five chunks of different colors, where the volume of each band determines how much of each section is lit, and that portion will diminish over time if a certain volume threshold is not met
@@ -408,10 +493,15 @@ void glitch(Strip_Buffer * buf, int len, Pattern_Data * params ) {
 /// @param buf Pointer to the Strip_Buffer structure, holds LED buffer and history variables.
 /// @param len The length of LEDs to process
 /// @param params Pointer to Pattern_Data structure containing configuration options.
-void bands(Strip_Buffer* buf, int len, Pattern_Data* params) {
+/// @param audio Pointer to Audio_Data structure holding this frame's audio features.
+template <uint8_t CONFIG>
+void bands(Strip_Buffer* buf, int len, Pattern_Data* params, Audio_Data* audio) {
     //double *fiveSamples = band_sample_bounce();
     
-    update_five_band_split(len); // Maybe use above if you want, but its generally agreed this one looks better
+    // Split into a local array, as other segments may be running
+    // this pattern at the same time with a different length.
+    double fbs[5];
+    temp_to_array(band_split_bounce(len), fbs, 5); // Maybe use above if you want, but its generally agreed this one looks better
     
     double avg1 = 0;
     double avg2 = 0;
@@ -426,7 +516,7 @@ void bands(Strip_Buffer* buf, int len, Pattern_Data* params) {
     double vol5 = fbs[4];
 
 
-      switch (params->config) {
+      switch (CONFIG) {
         case 0 : 
         {
             fadeToBlackBy(buf->leds, len, 85);
@@ -449,37 +539,20 @@ void bands(Strip_Buffer* buf, int len, Pattern_Data* params) {
             break;
         }
           case 1:{
-          // Calculate the volume of each band
-          for (int i = 0; i < advanced_size; i++) {
-            avg1 += buf->max1[i];    
-          }
-          avg1 /= advanced_size;
-          for (int i = 0; i < advanced_size; i++) {
-            avg2 += buf->max2[i];
+          Bands_State * state = (Bands_State *) buf->state;
+
+          // Read the falling average of each band. Each average keeps
+          // a running sum, so this does not loop over the history.
+          double avgs[5];
+          double vols[5] = {vol1, vol2, vol3, vol4, vol5};
+          for (int b = 0; b < 5; b++) {
+            avgs[b] = running_average_mean(&state->band_history[b]);
           }
-          avg2 /= advanced_size;
-          for (int i = 0; i < advanced_size; i++) {
-            avg3 += buf->max3[i];
-          }
-          avg3 /= advanced_size;
-          for (int i = 0; i < advanced_size; i++) {
-            avg4 += buf->max4[i];
-          }
-          avg4 /= advanced_size;
-          for (int i = 0; i < advanced_size; i++) {
-            avg5 += buf->max5[i];
-          }
-          avg5 /= advanced_size;
-
-          double *fiveSamples = band_split_bounce(len);
-
-          vol1 = fbs[0];
-          vol2 = fbs[1];
-          vol3 = fbs[2];
-          vol4 = fbs[3];
-          vol5 = fbs[4]; 
-
-          // Get the Five Sample Split ^
+          avg1 = avgs[0];
+          avg2 = avgs[1];
+          avg3 = avgs[2];
+          avg4 = avgs[3];
+          avg5 = avgs[4];
 
           if(config.debug_mode == 1){
             Serial.print("ADVANCED::\tAVG1:\t");
@@ -495,56 +568,22 @@ void bands(Strip_Buffer* buf, int len, Pattern_Data* params) {
           }
 
           // If there exists a new volume that is bigger than the falling pixel, reassign it to the top, otherwise make it fall for each band
-          if (vol1 <= avg1) {
-            buf->max1[buf->maxIter] = 0;
-          }
-          else {
-              for (int i = 0; i < 5; i++) {
-                buf->max1[i] = vol1;
-              }
-          }
-            
-          if (vol2 <= avg2) {
-            buf->max2[buf->maxIter] = 0;
-          }
-          else {
-              for (int i = 0; i < 5; i++) {
-                buf->max2[i] = vol2;
-              }
-          }
-
-          if (vol3 <= avg3) {
-            buf->max3[buf->maxIter] = 0;
-          }
-          else {
-              for (int i = 0; i < 5; i++) {
-                buf->max3[i] = vol3;
-              }
-          }
-
-          if (vol4 <= avg4) {
-            buf->max4[buf->maxIter] = 0;
-          }
-          else {
-              for (int i = 0; i < 5; i++) {
-                buf->max4[i] = vol4;
-              }
-          }
-
-          if (vol5 <= avg5) {
-            buf->max5[buf->maxIter] = 0;
-          }
-          else {
+          for (int b = 0; b < 5; b++) {
+            if (vols[b] <= avgs[b]) {
+              running_average_set(&state->band_history[b], state->maxIter, 0);
+            }
+            else {
               for (int i = 0; i < 5; i++) {
-                buf->max5[i] = vol5;
+                running_average_set(&state->band_history[b], i, vols[b]);
               }
+            }
           }
 
           // Get this smoothed array to loop to beginning again once it is at teh end of the falling pixel smoothing
-          if (buf->maxIter == advanced_size-1) {
-            buf->maxIter = 0;
+          if (state->maxIter == RUNNING_AVERAGE_DEFAULT-1) {
+            state->maxIter = 0;
           } else {
-            buf->maxIter++;
+            state->maxIter++;
           }
 
           // Fill the respective chunks of the light strip with the color based on above^
@@ -572,13 +611,12 @@ void bands(Strip_Buffer* buf, int len, Pattern_Data* params) {
           buf->leds[(int) 4*len/5+(int) avg5+ (int) vol5] = CRGB(255,255,255);
           fadeToBlackBy(buf->leds, len, 90);
 
-          delete [] fiveSamples;
           break;
         }
         case 2 :
         {
             // Grab the formants
-            double *temp_formants = density_formant();
+            double *temp_formants = formants;
             double f0Hue = remap(temp_formants[0], MIN_FREQUENCY, MAX_FREQUENCY, 0, 255);
             double f1Hue = remap(temp_formants[1], MIN_FREQUENCY, MAX_FREQUENCY, 0, 255);
             double f2Hue = remap(temp_formants[2], MIN_FREQUENCY, MAX_FREQUENCY, 0, 255);
@@ -593,40 +631,49 @@ void bands(Strip_Buffer* buf, int len, Pattern_Data* params) {
             }
 
             // Fill 1/3 with each formant
-            for (int i = 0; i < len; i++) {
-              if (i < len/3) {
-                buf->leds[i] = CHSV(f0Hue, 255, 255);
-              }
-              else if (len/3 <= i && i < 2*len/3) {
-                buf->leds[i] = CHSV(f1Hue, 255, 255);
-              } 
-              else { 
-                buf->leds[i] = CHSV(f2Hue, 255, 255);
-              }
-            }
+            fill_solid(buf->leds, len/3, hue_color(f0Hue));
+            fill_solid(&buf->leds[len/3], 2*len/3 - len/3, hue_color(f1Hue));
+            fill_solid(&buf->leds[2*len/3], len - 2*len/3, hue_color(f2Hue));
 
             // Smooth out the result
-            for (int i = 0; i < 5; i++) {
-              blur1d(buf->leds, len, 50);
-            }
-            delete[] temp_formants;
+            box_blur(buf->leds, len, 1, 2);
             break;
           }
       }
 }
 
-/// @brief Short and sweet function. Each pixel corresponds to a value from vReal, 
+/// The handler for each config of bands(), in config order.
+static const Pattern_Handler bands_handlers[] = { bands<0>, bands<1>, bands<2> };
+const Pattern_Configs bands_configs = { bands_handlers, ARRAY_SIZE(bands_handlers) };
+
+/// @brief Short and sweet function. Each pixel corresponds to a bin of vReal, spread evenly below Nyquist,
 ///         where the volume at each pitch determines the brightness of each pixel. Hue is locked in to a rainbow.
+///         Log bands config spreads the log-spaced filterbank across the strip instead, so each section covers the same musical interval.
 /// @param buf Pointer to the Strip_Buffer structure, holds LED buffer and history variables.
 /// @param len The length of LEDs to process
 /// @param params Pointer to Pattern_Data structure containing configuration options.
-void eq(Strip_Buffer * buf, int len, Pattern_Data* params) {
+/// @param audio Pointer to Audio_Data structure holding this frame's audio features.
+void eq(Strip_Buffer * buf, int len, Pattern_Data* params, Audio_Data* audio) {
+
+  if (params->config == 1) { // Log bands
+    uint8_t bands = filterbank_band_count();
+    Hue_Ramp ramp = hue_ramp(0, 255, len);
+    for (int i = 0; i < len; i++) {
+      double band = log_bands[i * bands / len];
+      int brit = map(band, MIN_FREQUENCY, MAX_FREQUENCY, 0, 255);
+      uint8_t hue = hue_ramp_next(&ramp);
+      buf->leds[i] = (band > 200) ? hue_color(hue, brit) : CRGB(0, 0, 0);
+    }
+    return;
+  }
   
+  Hue_Ramp ramp = hue_ramp(0, 255, len); // The hue is based on position on the light strip, ergo, what frequency it is at
   for (int i = 0; i < len; i++) {
-    int brit = map(vReal[i], MIN_FREQUENCY, MAX_FREQUENCY, 0, 255); // The brightness is based on HOW MUCH of the frequency exists
-    int hue = map(i, 0, len, 0, 255); // The fue is based on position on the light strip, ergo, what frequency it is at
-    if (vReal[i] > 200) { // An extra gate because the frequency array is really messy without it
-      buf->leds[i] = CHSV(hue, 255, brit);
+    double bin = vReal[i * (SAMPLES / 2) / len]; // Strips longer than the spectrum share bins
+    int brit = map(bin, MIN_FREQUENCY, MAX_FREQUENCY, 0, 255); // The brightness is based on HOW MUCH of the frequency exists
+    uint8_t hue = hue_ramp_next(&ramp);
+    if (bin > 200) { // An extra gate because the frequency array is really messy without it
+      buf->leds[i] = hue_color(hue, brit);
     }
   }
 }
@@ -635,18 +682,17 @@ void eq(Strip_Buffer * buf, int len, Pattern_Data* params) {
 /// @param buf Pointer to the Strip_Buffer structure, holds LED buffer and history variables.
 /// @param len The length of LEDs to process
 /// @param params Pointer to Pattern_Data structure containing configuration options.
-void random_raindrop(Strip_Buffer * buf, int len, Pattern_Data* params){
+/// @param audio Pointer to Audio_Data structure holding this frame's audio features.
+void random_raindrop(Strip_Buffer * buf, int len, Pattern_Data* params, Audio_Data* audio){
+    Particle_Pool * pool = (Particle_Pool *) buf->state;
     int startIdx = random(len);
 
-    buf->leds[startIdx] = CHSV(fHue, 255, vbrightness);
-    
-    for(int i = len-1; i > 0; i--) {
-      if (i != startIdx) {
-        buf->leds[i] = buf->leds[i-1];
-      }
-    }
+    particles_spawn(pool, PARTICLE_PIXEL(startIdx), PARTICLE_PIXEL(1), audio->fHue, 255, audio->vbrightness);
 
-    buf->leds[0] = CRGB::Black;
+    // Drops run one pixel a frame, fading as they go.
+    clearLEDSegment(buf, len);
+    particles_update(pool, len, RAINDROP_FADE);
+    particles_draw(pool, buf->leds, len);
 }
 
 /// @brief Strip is split into two sides, red and blue showing push and pull motion 
@@ -654,132 +700,178 @@ void random_raindrop(Strip_Buffer * buf, int len, Pattern_Data* params){
 /// @param buf Pointer to the Strip_Buffer structure, holds LED buffer and history variables.
 /// @param len The length of LEDs to process
 /// @param params Pointer to Pattern_Data structure containing configuration options.
-void tug_of_war(Strip_Buffer * buf, int len, Pattern_Data* params) {
+/// @param audio Pointer to Audio_Data structure holding this frame's audio features.
+template <uint8_t CONFIG>
+void tug_of_war(Strip_Buffer * buf, int len, Pattern_Data* params, Audio_Data* audio) {
     int splitPosition;
+    CRGB left = hue_color(params->minhue);
+    CRGB right = hue_color(params->maxhue);
     //use this function with smoothing for better results
     // red is on the left, blue is on the right
-    switch(params->config) {
+    switch(CONFIG) {
       case 0: // frequency
         {
           
-        double *formants = density_formant();
         double f0 = formants[0];
-        delete[] formants;
         splitPosition = remap(f0, MIN_FREQUENCY, MAX_FREQUENCY, 0, len);
 
         // red is on the left, blue is on the right
         for (int i = 0; i < len; i++) {
             if (i < splitPosition) {
-                buf->leds[i] = CHSV(params->minhue, 255, 255);
+                buf->leds[i] = left;
             } else {
-                buf->leds[i] = CHSV(params->maxhue, 255, 255);
+                buf->leds[i] = right;
             }
         }
     
         }
+        break;
       case 1: // volume
         {
-        splitPosition = remap(volume, MIN_VOLUME, MAX_VOLUME, 0, len);
+        splitPosition = remap(audio->volume, MIN_VOLUME, MAX_VOLUME, 0, len);
         for (int i = 0; i < len; i++) {
             if (i < splitPosition) {
-                buf->leds[i] = CHSV(params->minhue, 255, 255);
+                buf->leds[i] = left;
             } else {
-                buf->leds[i] = CHSV(params->maxhue, 255, 255);
+                buf->leds[i] = right;
             }
         }
         }
     }
 }
 
+/// The handler for each config of tug_of_war(), in config order.
+static const Pattern_Handler tug_of_war_handlers[] = { tug_of_war<0>, tug_of_war<1> };
+const Pattern_Configs tug_of_war_configs = { tug_of_war_handlers, ARRAY_SIZE(tug_of_war_handlers) };
+
+
+
+/// Random bytes the Fire2012 cooling step reads instead of
+/// calling random8() for every cell.
+static const uint8_t fire_noise[256] = {
+   49, 242, 186,  99, 168,   5, 158, 167, 242,  54, 141, 212, 106, 255, 150,  84,
+  208, 155, 186, 149,   0, 104, 219,  15,  16, 214,  88, 184, 194, 103, 181,  74,
+  212, 252,  57, 131,  71, 217, 165, 225,  75, 210, 179,  27, 232, 237, 128,  78,
+   67, 227,  35,  76, 240, 246,   2,  67,  31,  56, 170,   2,  74,   6,  17,  60,
+  209,  56,  10, 122, 181, 127, 208, 114, 155, 141,  72,  12, 161, 207,  34, 204,
+   25,  63, 150,  12,  65,   0, 137, 221,  46,  17, 224, 142, 237,  28, 115,  64,
+  204,  68, 206,  94,  95, 196, 230,  96, 126, 203,  82, 242,   4, 219,  94, 213,
+   94, 181, 105, 177, 232, 117, 148, 172, 230, 246,  45,  98,  32,  29, 157,  66,
+  185, 104,  66,   8,  94,  80, 103, 208, 178,  75,  12, 239, 126,  22,  10, 252,
+   29,  50,  87,  12, 250,   4,  93,  25,  16,  27,  99, 141, 190,  22, 244, 147,
+  131, 237, 246,  69, 254, 202, 152, 253, 137, 112, 120, 177,  10,  47,  11, 123,
+   32,  43, 166, 194,  28, 113,  53, 160, 140,  22,  44, 129, 238, 201, 235, 172,
+  202,  40, 128, 250, 159, 224, 189,  27, 255,  98, 191,  17,  14,  95, 164, 220,
+  192, 102, 168,  27, 216,  99,  17, 118,  65, 123, 170, 146, 192,  49,  16, 107,
+   96, 201, 108, 249, 225, 209, 196,  53, 144, 210, 208, 178, 134, 186,  89,  16,
+   66, 102, 150, 240, 206, 191,  73, 142, 100, 167,  78, 122, 244, 138, 242,  99
+};
+
+/// @brief Runs one column of the Fire2012 simulation.
+/// @param buf          Pointer to the Strip_Buffer structure, holds LED buffer and history variables.
+/// @param base         The index of the bottom cell of the column.
+/// @param stride       The distance between two cells of the column, going up.
+/// @param n            The number of cells in the column.
+/// @param spark_volume The chance of a new spark, out of 255.
+/// @param palette      The lookup table heat is colored with.
+///
+/// Each cell's heat is kept at the same index as its LED. Every
+/// step only uses integer math, and the cooling step walks the
+/// noise table from a new random start and stride each frame.
+static void fire_column(Strip_Buffer * buf, int base, int stride, int n, int spark_volume,
+                        const CRGB * palette){
 
-
-/// @brief Fire2012 pattern utilizing heating and cooling
-/// @param buf Pointer to the Strip_Buffer structure, holds LED buffer and history variables.
-/// @param len The length of LEDs to process
-/// @param params Pointer to Pattern_Data structure containing configuration options.
-void Fire2012(Strip_Buffer * buf, int len, Pattern_Data* params){
-  
-  int sparkVolume = remap(volume, MIN_VOLUME, MAX_VOLUME, 10,200);
-  //int coolingVolume = remap(volume, MIN_VOLUME, MAX_VOLUME, 60, 40);
-  //Serial.println(sparkVolume);
-  
-  
   // Array of temperature readings at each simulation cell
-  static byte heat[MAX_LEDS];
+  byte * heat = led_cells<byte>(buf->state);
 
 // Step 1.  Cool down every cell a little
-  for( int i = 0; i < config.length; i++) {
-    heat[i] = qsub8( heat[i],  random8(0, ((COOLING * 10) / config.length) + 2));
+  int max_cooling = min((COOLING * 10) / n + 2, 255);
+  uint8_t noise = random8();
+  uint8_t noise_step = random8() | 1; // Odd, so every table entry is visited.
+  for( int i = 0; i < n; i++) {
+    int c = base + i * stride;
+    heat[c] = qsub8( heat[c], (fire_noise[noise] * max_cooling) >> 8);
+    noise += noise_step;
   }
 
-  // Step 2.  Heat from each cell drifts 'up' and diffuses a little
-  for( int k= config.length - 1; k >= 2; k--) {
-    heat[k] = (heat[k - 1] + heat[k - 2] + heat[k - 2] ) / 3;
+  // Step 2.  Heat from each cell drifts 'up' and diffuses a little.
+  // Multiplying by 21846 / 65536 divides a sum of up to 765 by 3 exactly.
+  for( int k= n - 1; k >= 2; k--) {
+    uint32_t sum = heat[base + (k - 1) * stride] + 2 * heat[base + (k - 2) * stride];
+    heat[base + k * stride] = (sum * 21846) >> 16;
   }
   
   // Step 3.  Randomly ignite new 'sparks' of heat near the bottom
-  if( random8() < sparkVolume ) {
-    int y = random8(7);
+  if( random8() < spark_volume ) {
+    int y = base + random8(min(7, n)) * stride;
     heat[y] = qadd8( heat[y], random8(160,255) );
   }
-
-  //Step 3.5. Calcualate Brightness from low frequencies
-  int l = (sizeof(vReal)/sizeof(vReal[0])) / 7;
-  double smol_arr[l];
-  memcpy(smol_arr, vReal, l-1);
     
   // Step 4.  Map from heat cells to LED colors
-  for( int j = 0; j < config.length; j++) {
+  for( int j = 0; j < n; j++) {
     // Scale the heat value from 0-255 down to 0-240
     // for best results with color palettes.
+    int c = base + j * stride;
+    byte colorindex = scale8( heat[c], 240);
+    buf->leds[c] = palette[colorindex];
+  }
+}
+
+/// @brief Fire2012 pattern utilizing heating and cooling
+/// @param buf Pointer to the Strip_Buffer structure, holds LED buffer and history variables.
+/// @param len The length of LEDs to process
+/// @param params Pointer to Pattern_Data structure containing configuration options.
+/// @param audio Pointer to Audio_Data structure holding this frame's audio features.
+///
+/// On a 2D layout, every column burns upwards from the bottom row
+/// on its own. Otherwise, the whole strip is a single column.
+/// Heat is colored with the pattern's palette.
+void Fire2012(Strip_Buffer * buf, int len, Pattern_Data* params, Audio_Data* audio){
   
-    byte colorindex = scale8( heat[j], 240);
-    //byte colorindex = scale8( heat[j], smol_arr);
-    CRGB color = ColorFromPalette( gPal, colorindex);
-    int pixelnumber;
-    if( gReverseDirection ) {
-      pixelnumber = (config.length-1) - j;
-    } else {
-      pixelnumber = j;
-    }
-    buf->leds[pixelnumber] = color;
+  int sparkVolume = remap(audio->volume, MIN_VOLUME, MAX_VOLUME, 10,200);
+  //int coolingVolume = remap(volume, MIN_VOLUME, MAX_VOLUME, 60, 40);
+  //Serial.println(sparkVolume);
+
+  const CRGB * palette = palette_lut(params->palette);
+
+  int width, height;
+  if (layout_canvas(len, &width, &height)) {
+    for (int x = 0; x < width; x++)
+      fire_column(buf, (height - 1) * width + x, -width, height, sparkVolume, palette);
+  } else if (gReverseDirection) {
+    fire_column(buf, len - 1, -1, len, sparkVolume, palette);
+  } else {
+    fire_column(buf, 0, 1, len, sparkVolume, palette);
   }
 }
 
-void vowels_raindrop(Strip_Buffer * buf, int len, Pattern_Data* params){
-    int startIdx = random(len);
-    VowelSounds result = vowel_detection();
+void vowels_raindrop(Strip_Buffer * buf, int len, Pattern_Data* params, Audio_Data* audio){
+    Particle_Pool * pool = (Particle_Pool *) buf->state;
+    int16_t startIdx = PARTICLE_PIXEL(random(len));
+    VowelSounds result = current_vowel;
     switch (result) {
       case aVowel:
-        buf->leds[startIdx] = CRGB::Blue;
+        particles_spawn(pool, startIdx, PARTICLE_PIXEL(1), HUE_BLUE, 255, audio->vbrightness);
         break;
       case eVowel:
-        buf->leds[startIdx] = CRGB::Green;
+        particles_spawn(pool, startIdx, PARTICLE_PIXEL(1), HUE_GREEN, 255, audio->vbrightness);
         break;
       case iVowel:
-        buf->leds[startIdx] = CRGB::Red;
+        particles_spawn(pool, startIdx, PARTICLE_PIXEL(1), HUE_RED, 255, audio->vbrightness);
         break;
       case oVowel:
-        buf->leds[startIdx] = CRGB::Orange;
+        particles_spawn(pool, startIdx, PARTICLE_PIXEL(1), HUE_ORANGE, 255, audio->vbrightness);
         break;
       case uVowel:
-        buf->leds[startIdx] = CRGB::Yellow;
+        particles_spawn(pool, startIdx, PARTICLE_PIXEL(1), HUE_YELLOW, 255, audio->vbrightness);
         break;
       default: // no vowel is detected
-        buf->leds[startIdx] = CRGB::Black;
         break;
     }
 
-    buf->leds[startIdx] = CHSV(fHue, 255, vbrightness);
-    
-    for(int i = len-1; i > 0; i--) {
-      if (i != startIdx) {
-        buf->leds[i] = buf->leds[i-1];
-      }
-    }
-
-    buf->leds[0] = CRGB::Black;
-  
+    clearLEDSegment(buf, len);
+    particles_update(pool, len, RAINDROP_FADE);
+    particles_draw(pool, buf->leds, len);
 }
 
 #define VOLUME 0
@@ -789,19 +881,21 @@ void vowels_raindrop(Strip_Buffer * buf, int len, Pattern_Data* params){
 /// @param buf Pointer to the Strip_Buffer structure, holds LED buffer and history variables.
 /// @param len The length of LEDs to process
 /// @param params Pointer to Pattern_Data structure containing configuration options.
-void bar_fill(Strip_Buffer * buf, int len, Pattern_Data* params){
+/// @param audio Pointer to Audio_Data structure holding this frame's audio features.
+template <uint8_t CONFIG>
+void bar_fill(Strip_Buffer * buf, int len, Pattern_Data* params, Audio_Data* audio){
 
-  uint8_t max_height = 0;
+  int max_height = 0;
 
-  switch(params->config) {
+  switch(CONFIG) {
 
     case VOLUME: default: {
-      max_height = remap(volume, MIN_VOLUME * 4, MAX_VOLUME/2, 0, len-1);
+      max_height = remap(audio->volume, MIN_VOLUME * 4, MAX_VOLUME/2, 0, len-1);
       break;
     }
 
     case FREQUENCY: {
-      max_height = map(peak, MIN_FREQUENCY * 4, MAX_FREQUENCY/2, 0, len-1);
+      max_height = map(audio->peak, MIN_FREQUENCY * 4, MAX_FREQUENCY/2, 0, len-1);
       break;
     }
   }
@@ -809,18 +903,18 @@ void bar_fill(Strip_Buffer * buf, int len, Pattern_Data* params){
   uint8_t hue_step = (params->maxhue - params->minhue) / (len - 1);
 
   // Apply the color to the strip.
-  for(uint8_t i = 0; i < max_height; i++){
-    buf->leds[i] = CHSV(
-      (params->minhue + hue_step * (i - 1)) % 255,
-      255,
-      255
-    );
+  for(int i = 0; i < max_height; i++){
+    buf->leds[i] = hue_color((params->minhue + hue_step * (i - 1)) % 255);
   }
 
   // Black out the rest of the strip.
-  for(uint8_t i = max_height; i < len; i++){
+  for(int i = max_height; i < len; i++){
     buf->leds[i] = CHSV(0, 0, 0);
   }
   
 }
 
+/// The handler for each config of bar_fill(), in config order.
+static const Pattern_Handler bar_fill_handlers[] = { bar_fill<VOLUME>, bar_fill<FREQUENCY> };
+const Pattern_Configs bar_fill_configs = { bar_fill_handlers, ARRAY_SIZE(bar_fill_handlers) };
+
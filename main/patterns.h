@@ -8,51 +8,135 @@
 #ifndef PATTERNS_H
 #define PATTERNS_H
 
+#include <new>
 #include "nanolux_types.h"
 #include "storage.h"
+#include "envelope.h"
+#include "particles.h"
 
 /// @brief Holds persistent data for currently-running patterns.
 ///
-/// This structure contains both persistent variables that can
-/// be reused on a per-subpattern basis.
+/// This structure contains the LED buffer for a subpattern. The
+/// main advantage of defining it here is that each subpattern
+/// can have an independent pattern buffer separate from the main
+/// ones in main.ino.
 ///
-/// It also contains the LED buffer for that subpattern. The main
-/// advantage of defining it here is that each subpattern can have
-/// an independent pattern buffer separate from the main ones
-/// in main.ino.
+/// The LED buffer holds one pixel per LED on the strip. It is
+/// allocated from the arena whenever the strip length changes.
+///
+/// Any other history a pattern needs lives in its own state type,
+/// declared in the pattern registry. That state is allocated from
+/// the arena the first time the pattern runs, and "state" points
+/// to it. The state is always built and run for the pattern in
+/// "idx", not the live Pattern_Data index, which the web server
+/// may change at any time.
 ///
 /// When a subpattern is modified in a way that requires a reset
 /// (changing the subpattern name, changing LED length), the
-/// existing pattern history should be replaced with the default
-/// structure.
+/// LED buffer should be cleared and the state pointer dropped.
 typedef struct{
 
   // Pattern Buffer for the particular history being used.
-  CRGB leds[MAX_LEDS] = {0};
+  CRGB * leds = nullptr;
+
+  // The pattern's typed state, or nullptr if not allocated yet.
+  void * state = nullptr;
+
+  // The index of the pattern this buffer and state belong to.
+  uint8_t idx = 0;
+
+} Strip_Buffer;
+
+/// @brief A crossfade from a replaced pattern to its replacement.
+///
+/// The outgoing pattern keeps its buffer and state, and keeps
+/// rendering until the fade is done.
+typedef struct{
+
+  bool active = false;      /// If a crossfade is running.
+  uint8_t slot = 0;         /// The loaded pattern slot being crossfaded.
+  uint32_t start = 0;       /// The time the crossfade started, in ms.
+  Pattern_Data outgoing;    /// The settings of the replaced pattern.
+  Strip_Buffer buffer;      /// The buffer and state of the replaced pattern.
 
-  // History Variables
-  int frame = 0;                 // for spring mass 
-  double amplitude = 0;          //for spring mass 2
+} Transition;
+
+/// @brief Constructs a pattern's state type in place.
+/// @param mem Arena memory large enough to hold a T.
+///
+/// The arena may move state when it is compacted, so state
+/// types must not hold pointers into themselves.
+template <typename T>
+void construct_state(void * mem){
+  new (mem) T();
+}
+
+/// @brief Finds the per-LED cells that follow a pattern's state.
+/// @param state The pattern's state, declared with PATTERN_STATE_PER_LED.
+template <typename E, typename T>
+E * state_cells(T * state){
+  return (E *) (state + 1);
+}
+
+/// @brief Finds the per-LED cells of a pattern declared with PATTERN_CELLS.
+/// @param state The pattern's state.
+template <typename E>
+E * led_cells(void * state){
+  return (E *) state;
+}
+
+/// Registry helpers for declaring a pattern's state type.
+/// PATTERN_STATE_PER_LED(T, E) also allocates one E per LED on
+/// the strip right after the T, zeroed before T is constructed.
+/// PATTERN_CELLS(E) allocates only the zeroed cells, one E per LED.
+#define PATTERN_STATE(T) sizeof(T), 0, construct_state<T>
+#define PATTERN_STATE_PER_LED(T, E) sizeof(T), sizeof(E), construct_state<T>
+#define PATTERN_CELLS(E) 0, sizeof(E), nullptr
+#define NO_STATE 0, 0, nullptr
+
+/// History used by pix_freq(). The trail holds the pixels
+/// the two markers left behind, fading out.
+typedef struct{
   int tempHue = 0;
   int vol_pos = 0;
   int pix_pos = 0;
-  uint8_t genre_smoothing[10] = {0, 0, 0, 0, 0, 0, 0, 0, 0, 0};
-  int genre_pose = 0;
-  double max1[20] = {0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0};
-  double max2[20] = {0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0};
-  double max3[20] = {0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0};
-  double max4[20] = {0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0};
-  double max5[20] = {0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0};
+  Particle_Pool trail;
+} Pix_Freq_State;
+
+/// History used by bands().
+typedef struct{
+  Running_Average band_history[5]; // for advanced bands
   int maxIter = 0;
-  double velocity = 0;
-  double acceleration = 0;
-  double smoothing_value[10] = {0,0,0,0,0,0,0,0,0,0};
-  int location = 70;
-  double velocities[5] = {0,0,0,0,0};
-  double accelerations[5] = {0,0,0,0,0};
-  int locations[5] = {70,60,50,40,30};
-  double vRealSums[5] = {0,0,0,0,0};
-} Strip_Buffer;
+} Bands_State;
+
+/// @brief Audio features a pattern renders from during one frame.
+///
+/// Filled in by process_pattern() right before the pattern runs.
+/// When the pattern has a band focus, volume and peak only
+/// cover the FFT bins inside that band.
+typedef struct{
+
+  double volume = 0;       /// Volume inside the pattern's band.
+  double peak = 0;         /// Peak frequency inside the pattern's band, in Hz.
+  uint8_t fHue = 0;        /// Hue calculated from the peak frequency.
+  uint8_t vbrightness = 0; /// Brightness calculated from the volume.
+
+} Audio_Data;
+
+/// A function that renders one frame of a pattern.
+typedef void (*Pattern_Handler)(Strip_Buffer * buf, int len, Pattern_Data* params, Audio_Data* audio);
+
+/// @brief The handlers of a pattern that has several configs.
+///
+/// Each config is its own handler, specialized from a template
+/// on the config number, so the config is never checked while
+/// rendering.
+typedef struct{
+
+  const Pattern_Handler * handlers; /// One handler per config, in config order.
+  uint8_t count; /// The number of configs.
+
+} Pattern_Configs;
 
 extern Pattern_Data params;
 
@@ -62,40 +146,38 @@ void clearLEDSegment(Strip_Buffer * buf, int len);
 
 void setColorHSV(CRGB* leds, byte h, byte s, byte v, int len);
 
-// void getFhue(uint8_t min_hue, uint8_t max_hue);
-
-void getFhue(uint8_t min_hue, uint8_t max_hue);
+uint8_t getFhue(double peak, uint8_t min_hue, uint8_t max_hue);
 
-void getVbrightness();
+uint8_t getVbrightness(double volume);
 
-void blank(Strip_Buffer * buf, int len, Pattern_Data* params);
+void blank(Strip_Buffer * buf, int len, Pattern_Data* params, Audio_Data* audio);
 
-void confetti(Strip_Buffer * buf, int len, Pattern_Data* params);
+void confetti(Strip_Buffer * buf, int len, Pattern_Data* params, Audio_Data* audio);
 
-void pix_freq(Strip_Buffer * buf, int len, Pattern_Data* params);
+void pix_freq(Strip_Buffer * buf, int len, Pattern_Data* params, Audio_Data* audio);
 
-void eq(Strip_Buffer * buf, int len, Pattern_Data* params);
+void eq(Strip_Buffer * buf, int len, Pattern_Data* params, Audio_Data* audio);
 
-void tug_of_war(Strip_Buffer * buf, int len, Pattern_Data* params);
+extern const Pattern_Configs tug_of_war_configs;
 
-void saturated(Strip_Buffer * buf, int len, Pattern_Data* params);
+extern const Pattern_Configs saturated_configs;
 
-void random_raindrop(Strip_Buffer * buf, int len, Pattern_Data* params);
+void random_raindrop(Strip_Buffer * buf, int len, Pattern_Data* params, Audio_Data* audio);
 
-void hue_trail(Strip_Buffer* buf, int len, Pattern_Data* params);
+extern const Pattern_Configs hue_trail_configs;
 
-void groovy(Strip_Buffer* buf, int len, Pattern_Data* params);
+void groovy(Strip_Buffer* buf, int len, Pattern_Data* params, Audio_Data* audio);
 
-void talking(Strip_Buffer *buf, int len, Pattern_Data *params);
+extern const Pattern_Configs talking_configs;
 
-void glitch(Strip_Buffer * buf, int len, Pattern_Data * params);
+extern const Pattern_Configs glitch_configs;
 
-void bands(Strip_Buffer * buf, int len, Pattern_Data * params);
+extern const Pattern_Configs bands_configs;
 
-void Fire2012(Strip_Buffer * buf, int len, Pattern_Data* params);
+void Fire2012(Strip_Buffer * buf, int len, Pattern_Data* params, Audio_Data* audio);
 
-void bar_fill(Strip_Buffer * buf, int len, Pattern_Data* params);
+extern const Pattern_Configs bar_fill_configs;
 
-void vowels_raindrop(Strip_Buffer * buf, int len, Pattern_Data* params);
+void vowels_raindrop(Strip_Buffer * buf, int len, Pattern_Data* params, Audio_Data* audio);
 
 #endif
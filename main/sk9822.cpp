@@ -0,0 +1,154 @@
+/** @file
+  *
+  * This file's functions encode frames for SK9822 LED strips and
+  * send them over SPI with DMA, one SPI host per output channel.
+  *
+  * sk9822_encode() is a pure function, so it also builds and runs
+  * without the ESP32 hardware.
+  *
+*/
+
+#include <string.h>
+#include "nanolux_types.h"
+#include "storage.h"
+#include "sk9822.h"
+
+/// @brief Encodes a frame of LED colors into SK9822 wire format.
+/// @param leds       The LED colors to encode.
+/// @param len        The number of LEDs to encode.
+/// @param brightness The 5-bit global brightness sent to every LED.
+/// @param correction Color correction, scaling each channel by its value out of 255.
+/// @param out        The buffer to write the frame to.
+/// @param out_size   The size of the buffer, in bytes.
+/// @returns The number of bytes written, or 0 if the buffer is too small.
+///
+/// A frame is four zero bytes, then one brightness byte and the
+/// blue, green and red channels for every LED, then the end frame.
+size_t sk9822_encode(const CRGB * leds, uint16_t len, uint8_t brightness,
+                     CRGB correction, uint8_t * out, size_t out_size){
+
+  size_t size = sk9822_frame_size(len);
+  if (size > out_size) return 0;
+
+  if (brightness > SK9822_MAX_BRIGHTNESS) brightness = SK9822_MAX_BRIGHTNESS;
+  uint8_t header = SK9822_LED_HEADER | brightness;
+
+  memset(out, 0, SK9822_START_BYTES);
+  uint8_t * p = out + SK9822_START_BYTES;
+
+  for (uint16_t i = 0; i < len; i++) {
+    *p++ = header;
+    *p++ = scale8(leds[i].b, correction.b);
+    *p++ = scale8(leds[i].g, correction.g);
+    *p++ = scale8(leds[i].r, correction.r);
+  }
+
+  memset(p, 0, out + size - p);
+  return size;
+}
+
+#if defined(ARDUINO) && defined(SPI_LED_OUTPUT)
+
+#include <driver/spi_master.h>
+#include <esp_heap_caps.h>
+
+#if OUTPUT_CHANNELS > 2
+#error "SPI LED output drives at most two channels, one per free SPI host."
+#endif
+
+/// The SPI host every channel sends through.
+static const spi_host_device_t channel_hosts[2] = { SPI2_HOST, SPI3_HOST };
+
+/// The frame each channel is sending, in DMA-capable memory.
+static uint8_t * channel_frames[OUTPUT_CHANNELS];
+
+/// The number of bytes each channel's frame buffer holds.
+static size_t frame_capacity[OUTPUT_CHANNELS];
+
+/// The SPI device for each channel's LED strip.
+static spi_device_handle_t strips[OUTPUT_CHANNELS];
+
+/// The transfer each channel has queued.
+static spi_transaction_t transactions[OUTPUT_CHANNELS];
+
+/// If each channel has a transfer that was not waited on yet.
+static bool in_flight[OUTPUT_CHANNELS];
+
+/// @brief Routes an SPI peripheral to a channel's LED pins.
+/// @param ch       The output channel, which picks the SPI host.
+/// @param data_pin The pin the strip's data line is wired to.
+/// @param clk_pin  The pin the strip's clock line is wired to.
+/// @param clock_hz The SPI clock rate, in Hz.
+/// @returns True if the SPI bus and device were set up.
+bool sk9822_begin(uint8_t ch, int data_pin, int clk_pin, uint32_t clock_hz){
+
+  if (ch >= OUTPUT_CHANNELS) return false;
+
+  spi_bus_config_t bus = {};
+  bus.mosi_io_num = data_pin;
+  bus.miso_io_num = -1;
+  bus.sclk_io_num = clk_pin;
+  bus.quadwp_io_num = -1;
+  bus.quadhd_io_num = -1;
+  bus.max_transfer_sz = (sk9822_frame_size(MAX_LEDS) + 3) & ~3;
+
+  if (spi_bus_initialize(channel_hosts[ch], &bus, SPI_DMA_CH_AUTO) != ESP_OK)
+    return false;
+
+  spi_device_interface_config_t dev = {};
+  dev.clock_speed_hz = clock_hz;
+  dev.mode = 0;
+  dev.spics_io_num = -1;
+  dev.queue_size = 1;
+
+  return spi_bus_add_device(channel_hosts[ch], &dev, &strips[ch]) == ESP_OK;
+}
+
+/// @brief Returns a channel's DMA buffer, grown to fit (size) bytes.
+static uint8_t * acquire_frame(uint8_t ch, size_t size, void * ctx){
+
+  if (!strips[ch]) return nullptr;
+
+  // Word aligned for DMA.
+  size_t needed = (size + 3) & ~3;
+  if (needed > frame_capacity[ch]) {
+    heap_caps_free(channel_frames[ch]);
+    channel_frames[ch] = (uint8_t *) heap_caps_malloc(needed, MALLOC_CAP_DMA);
+    frame_capacity[ch] = (channel_frames[ch]) ? needed : 0;
+  }
+
+  return channel_frames[ch];
+}
+
+/// @brief Queues a channel's encoded frame on its SPI host.
+static void send_frame(uint8_t ch, const uint8_t * data, size_t size, void * ctx){
+
+  transactions[ch] = {};
+  transactions[ch].length = size * 8;
+  transactions[ch].tx_buffer = data;
+
+  in_flight[ch] = spi_device_queue_trans(strips[ch], &transactions[ch], portMAX_DELAY) == ESP_OK;
+}
+
+/// @brief Sleeps until every queued channel has been sent.
+static void finish_frames(void * ctx){
+
+  for (uint8_t ch = 0; ch < OUTPUT_CHANNELS; ch++) {
+    if (!in_flight[ch]) continue;
+
+    spi_transaction_t * done;
+    spi_device_get_trans_result(strips[ch], &done, portMAX_DELAY);
+    in_flight[ch] = false;
+  }
+}
+
+/// @brief Returns the sink that sends channels over SPI with DMA.
+///
+/// Every channel's transfer runs at the same time, and the
+/// calling task sleeps until all of them are done.
+const Channel_Sink * sk9822_sink(){
+  static const Channel_Sink sink = { acquire_frame, send_frame, finish_frames, nullptr };
+  return &sink;
+}
+
+#endif
@@ -0,0 +1,45 @@
+/**@file
+ *
+ * This file contains function headers for sk9822.cpp.
+ *
+ * The SK9822 driver sends frames to the LED strips through the
+ * ESP32's SPI peripherals with DMA, so the CPU is free while a
+ * frame is clocked out. Each output channel has its own SPI
+ * host, so channels are sent at the same time.
+ *
+**/
+
+#ifndef SK9822_H
+#define SK9822_H
+
+#include <stddef.h>
+#include <FastLED.h>
+#include "channels.h"
+
+/// The number of zero bytes that start every frame.
+#define SK9822_START_BYTES 4
+
+/// The number of bytes each LED takes.
+#define SK9822_LED_BYTES 4
+
+/// The top three bits of every LED's first byte.
+#define SK9822_LED_HEADER 0xE0
+
+/// The largest global brightness, which is 5 bits wide.
+#define SK9822_MAX_BRIGHTNESS 31
+
+/// @brief Returns the number of bytes in a frame for (len) LEDs.
+///
+/// After the LEDs, SK9822 strips need four zero bytes to latch the
+/// frame, plus one clock edge per two LEDs to push the data to the
+/// end of the strip.
+constexpr size_t sk9822_frame_size(uint16_t len){
+  return SK9822_START_BYTES + SK9822_LED_BYTES * len + 4 + (len + 15) / 16;
+}
+
+size_t sk9822_encode(const CRGB * leds, uint16_t len, uint8_t brightness,
+                     CRGB correction, uint8_t * out, size_t out_size);
+bool sk9822_begin(uint8_t ch, int data_pin, int clk_pin, uint32_t clock_hz);
+const Channel_Sink * sk9822_sink();
+
+#endif
@@ -11,12 +11,15 @@
 #include <string>
 #include <Preferences.h>
 #include "storage.h"
+#include "nanolux_types.h"
 #include "nanolux_util.h"
 
 #define PATTERN_NAMESPACE "p"
 #define PATTERN_KEY       "k"
 #define CONFIG_NAMESPACE  "c"
 #define CONFIG_KEY        "f"
+#define LAYOUT_NAMESPACE  "l"
+#define LAYOUT_KEY        "m"
 
 /// The currently strip configuration, externed from main.ino.
 extern Strip_Data loaded_patterns;
@@ -69,6 +72,10 @@ void bound_user_data() {
     bound_byte(&loaded_patterns.pattern[i].brightness, 0, 255);
     bound_byte(&loaded_patterns.pattern[i].smoothing, 0, 225);
     bound_byte(&loaded_patterns.pattern[i].idx, 0, NUM_PATTERNS);
+    bound_byte(&loaded_patterns.pattern[i].band_low, 0, SAMPLES/2 - 1);
+    bound_byte(&loaded_patterns.pattern[i].band_high, 0, SAMPLES/2 - 1);
+    bound_byte(&loaded_patterns.pattern[i].blend_mode, 0, NUM_BLEND_MODES - 1);
+    bound_byte(&loaded_patterns.pattern[i].palette, 0, NUM_PALETTES - 1);
   }
 }
 
@@ -77,8 +84,15 @@ void bound_user_data() {
 /// This function should not be called by itself.
 void bound_system_settings() {
   bound_byte(&config.debug_mode, 0, 2);
-  bound_byte(&config.length, 30, 200);
+  bound_word(&config.length, MIN_LEDS, MAX_LEDS);
   bound_byte(&config.loop_ms, 15, 100);
+  config.transition_ms = min(config.transition_ms, (uint16_t) MAX_TRANSITION_MS);
+  bound_byte(&config.layout, 0, NUM_LAYOUTS - 1);
+  bound_word(&config.layout_width, 0, MAX_LEDS);
+  bound_byte(&config.layout_rotation, 0, 3);
+
+  for(int i = 0; i < OUTPUT_CHANNELS; i++)
+    bound_word(&config.channel_length[i], 0, MAX_LEDS);
 }
 
 /************************************************
@@ -161,6 +175,32 @@ void save_config_to_nvs() {
   storage.end();
 }
 
+/// @brief Saves a custom pixel layout map to NVS.
+/// @param map The physical pixel of every logical pixel.
+/// @param len The number of pixels in the map.
+void save_layout_map_to_nvs(const uint16_t * map, uint16_t len) {
+  storage.begin(LAYOUT_NAMESPACE, false);
+  storage.putBytes(LAYOUT_KEY, map, sizeof(uint16_t) * len);
+  storage.end();
+}
+
+/// @brief Loads the custom pixel layout map from NVS.
+/// @param map     The array to load the map into.
+/// @param max_len The most pixels the array can hold.
+/// @returns The number of pixels loaded, or 0 if none was saved.
+uint16_t load_layout_map_from_nvs(uint16_t * map, uint16_t max_len) {
+  uint16_t len = 0;
+
+  storage.begin(LAYOUT_NAMESPACE, true);
+  if (storage.isKey(LAYOUT_KEY)) {
+    len = min(storage.getBytesLength(LAYOUT_KEY) / sizeof(uint16_t), (size_t) max_len);
+    storage.getBytes(LAYOUT_KEY, map, sizeof(uint16_t) * len);
+  }
+  storage.end();
+
+  return len;
+}
+
 /// @brief Ensures that saved settings have reasonable data.
 ///
 /// TODO: Is this function even needed anymore?
@@ -179,7 +219,9 @@ void load_from_nvs() {
 
   storage.begin(PATTERN_NAMESPACE, false);
 
-  if (storage.isKey(PATTERN_KEY)) {
+  // Saves written with a different pattern layout cannot be read
+  // back, so the default patterns are kept instead.
+  if (storage.isKey(PATTERN_KEY) && storage.getBytesLength(PATTERN_KEY) == sizeof(Strip_Data) * NUM_SAVES) {
     storage.getBytes(
       PATTERN_KEY,
       &saved_patterns[0],
@@ -190,7 +232,9 @@ void load_from_nvs() {
 
   storage.begin(CONFIG_NAMESPACE, false);
 
-  if (storage.isKey(CONFIG_KEY))
+  // Configs saved with a different layout cannot be read back,
+  // so the defaults are kept instead.
+  if (storage.isKey(CONFIG_KEY) && storage.getBytesLength(CONFIG_KEY) == sizeof(Config_Data))
     storage.getBytes(CONFIG_KEY, &config, sizeof(Config_Data));
 
   storage.end();
@@ -200,6 +244,7 @@ void load_from_nvs() {
     config.debug_mode = 0;
     config.length = 60;
     config.loop_ms = 40;
+    config.transition_ms = 500;
   }
 
   bound_system_settings();
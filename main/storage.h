@@ -36,6 +36,9 @@
 /// The number of patterns that can run at maximum.
 #define PATTERN_LIMIT 4
 
+/// The number of physical strips the device drives side by side.
+#define OUTPUT_CHANNELS 2
+
 
 
 typedef struct{
@@ -47,6 +50,11 @@ typedef struct{
   uint8_t maxhue = 255;
   uint8_t config = 0; // diffrent configs
   uint8_t postprocessing_mode = 0; // The current mode for postprocessing
+  uint8_t band_low = 0; /// The lowest FFT bin the pattern listens to.
+  uint8_t band_high = 0; /// The highest FFT bin the pattern listens to. 0 listens to every bin.
+  uint8_t opacity = 255; /// How opaque the pattern is as a layer in Z-layering.
+  uint8_t blend_mode = 0; /// How the pattern blends onto the layers below it.
+  uint8_t palette = 0; /// The color palette the pattern draws with, such as PALETTE_HOT.
   
 } Pattern_Data;
   
@@ -54,7 +62,7 @@ typedef struct{
 /// A structure holding strip configuration data.
 typedef struct{
 
-  uint8_t alpha = 0; /// How transparent the top pattern is in Z-layering.
+  uint8_t alpha = 0; /// How transparent the layers above the first are in Z-layering.
   uint8_t noise_thresh = 0; /// The minimum noise floor to consider as audio.
   uint8_t mode = 0; /// The currently-running pattern mode (splitting vs layering).
   uint8_t pattern_count = 1; /// The number of patterns this config has.
@@ -65,11 +73,16 @@ typedef struct{
 /// A structure holding system configuration data.
 typedef struct{
 
-  uint8_t length = 60; /// The length of the LED strip.
+  uint16_t length = 60; /// The length of the LED strip.
   uint8_t loop_ms = 40; /// The number of milliseconds one program loop takes.
   uint8_t debug_mode = 0; /// The currently selected debug output mode.
   bool init = true; /// If the loaded config data is valid.
   char pass[16] = ""; // The current device password
+  uint16_t transition_ms = 500; /// How long pattern changes crossfade for, in ms.
+  uint8_t layout = 0; /// How pixels are wired, such as LAYOUT_SERPENTINE.
+  uint16_t layout_width = 0; /// The number of pixels in each wired row. 0 is one strip.
+  uint8_t layout_rotation = 0; /// Quarter turns clockwise the canvas is rotated by.
+  uint16_t channel_length[OUTPUT_CHANNELS] = {0}; /// LEDs on each output channel. 0 takes the rest of the strip.
 
 } Config_Data;
 
@@ -80,6 +93,8 @@ void save_to_nvs();
 void clear_all();
 void load_from_nvs();
 void save_config_to_nvs();
+void save_layout_map_to_nvs(const uint16_t * map, uint16_t len);
+uint16_t load_layout_map_from_nvs(uint16_t * map, uint16_t max_len);
 void verify_saves();
 
 #endif
\ No newline at end of file
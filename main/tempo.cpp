@@ -0,0 +1,162 @@
+/** @file
+  *
+  * This file's functions track the tempo of incoming audio and
+  * keep a beat clock that patterns can animate from.
+  *
+  * The tempo_beat functions are drop-in replacements for
+  * FastLED's beat16(), beat8() and beatsin16(). While a tempo is
+  * locked, a requested BPM is rounded to the nearest power-of-two
+  * number of beats, so motion stays in step with the music. When
+  * no tempo is locked, they fall back to the FastLED functions.
+  *
+*/
+
+#include <FastLED.h>
+#include <Arduino.h>
+#include <math.h>
+#include "nanolux_types.h"
+#include "tempo.h"
+
+/// Onsets are volumes this many times above the volume floor.
+#define ONSET_RATIO 1.5
+
+/// The rate the volume floor follows the volume at, in Q16.
+#define FLOOR_RATE 1500
+
+/// The system tempo clock.
+Tempo_Clock tempo_clock;
+
+/// @brief Configures the tempo clock. Call once during setup.
+void setup_tempo(){
+  envelope_init(&tempo_clock.floor, FLOOR_RATE, FLOOR_RATE, 0);
+}
+
+/// @brief Folds a beat interval into the tracked BPM range.
+/// @param interval The time between two onsets, in ms.
+/// @returns The folded tempo, in Q8.8 BPM.
+static uint32_t interval_to_bpm(uint32_t interval){
+  uint32_t bpm = (60000UL << 8) / interval;
+  while(bpm < (TEMPO_MIN_BPM << 8)) bpm *= 2;
+  while(bpm > (TEMPO_MAX_BPM << 8)) bpm /= 2;
+  return bpm;
+}
+
+/// @brief Updates the tracked tempo and beat phase with a new onset.
+/// @param now The time of the onset, in ms.
+static void register_onset(uint32_t now){
+
+  uint32_t interval = now - tempo_clock.last_onset;
+  tempo_clock.last_onset = now;
+
+  // The first onset after silence only starts the interval.
+  if(interval > TEMPO_TIMEOUT) return;
+
+  int32_t measured = interval_to_bpm(interval);
+  int32_t current = tempo_clock.bpm;
+
+  if(abs(measured - current) < current / 10){
+    // The onset matches the tempo, so trust it more and nudge
+    // the tempo towards it.
+    if(tempo_clock.confidence < 8) tempo_clock.confidence++;
+    tempo_clock.bpm = current + (measured - current) / 4;
+  }else if(tempo_clock.confidence > 0){
+    tempo_clock.confidence--;
+  }else{
+    // Nothing is locked, so start tracking the new tempo.
+    tempo_clock.bpm = measured;
+  }
+
+  // Pull the phase towards the nearest beat. Snap to it while
+  // searching for a tempo, and correct half the error once locked.
+  int32_t error = tempo_clock.phase & 0xFFFF;
+  if(error >= 32768) error -= 65536;
+  tempo_clock.phase -= (tempo_locked()) ? error / 2 : error;
+}
+
+/// @brief Advances the tempo clock by one frame.
+/// @param volume The current volume.
+/// @param now    The current time, in ms.
+///
+/// Runs in constant time. Onsets are detected as the volume
+/// crossing above a slowly-moving floor.
+void update_tempo(double volume, uint32_t now){
+
+  uint32_t elapsed = (tempo_clock.last_update) ? now - tempo_clock.last_update : 0;
+  tempo_clock.last_update = now;
+
+  // Advance the phase by the beats elapsed since the last frame.
+  tempo_clock.phase += ((uint64_t) elapsed * tempo_clock.bpm << 16) / (60000UL << 8);
+
+  double floor = envelope_update(&tempo_clock.floor, volume);
+  bool above = volume > floor * ONSET_RATIO && volume > MIN_VOLUME;
+
+  if(above && !tempo_clock.above && now - tempo_clock.last_onset >= TEMPO_MIN_INTERVAL)
+    register_onset(now);
+
+  tempo_clock.above = above;
+
+  // Drop the lock if the music stopped.
+  if(now - tempo_clock.last_onset > TEMPO_TIMEOUT)
+    tempo_clock.confidence = 0;
+}
+
+/// @brief Checks if the clock is following a detected tempo.
+bool tempo_locked(){
+  return tempo_clock.confidence >= TEMPO_LOCK_CONFIDENCE;
+}
+
+/// @brief Returns the tracked tempo, in Q8.8 BPM.
+accum88 tempo_bpm(){
+  return tempo_clock.bpm;
+}
+
+/// @brief Tempo-locked replacement for FastLED's beat16().
+/// @param beats_per_minute The speed to run at when no tempo is locked.
+/// @param timebase         Passed to beat16() when no tempo is locked.
+/// @returns A sawtooth that wraps once per cycle.
+///
+/// While locked, one cycle lasts the power-of-two number of beats
+/// closest to the requested speed.
+uint16_t tempo_beat16(accum88 beats_per_minute, uint32_t timebase){
+
+  if(!tempo_locked())
+    return beat16(beats_per_minute, timebase);
+
+  if(beats_per_minute < 256) beats_per_minute <<= 8;
+  if(beats_per_minute == 0) beats_per_minute = 1;
+
+  // Find the closest power-of-two number of beats per cycle.
+  float ratio = (float) tempo_clock.bpm / beats_per_minute;
+  int shift = lroundf(log2f(ratio));
+  shift = constrain(shift, -4, 15);
+
+  return (shift >= 0)
+    ? (uint16_t) (tempo_clock.phase >> shift)
+    : (uint16_t) (tempo_clock.phase << -shift);
+}
+
+/// @brief Tempo-locked replacement for FastLED's beat8().
+/// @param beats_per_minute The speed to run at when no tempo is locked.
+/// @param timebase         Passed to beat8() when no tempo is locked.
+uint8_t tempo_beat8(accum88 beats_per_minute, uint32_t timebase){
+  return tempo_beat16(beats_per_minute, timebase) >> 8;
+}
+
+/// @brief Tempo-locked replacement for FastLED's beatsin16().
+/// @param beats_per_minute The speed to run at when no tempo is locked.
+/// @param lowest           The lowest value to output.
+/// @param highest          The highest value to output.
+/// @param timebase         Passed to beatsin16() when no tempo is locked.
+/// @param phase_offset     Shifts the wave, in 1/65536 of a cycle.
+/// @returns A sine wave between lowest and highest.
+uint16_t tempo_beatsin16(accum88 beats_per_minute, uint16_t lowest, uint16_t highest,
+                         uint32_t timebase, uint16_t phase_offset){
+
+  if(!tempo_locked())
+    return beatsin16(beats_per_minute, lowest, highest, timebase, phase_offset);
+
+  uint16_t beat = tempo_beat16(beats_per_minute, timebase);
+  uint16_t beatsin = sin16(beat + phase_offset) + 32768;
+  uint16_t rangewidth = highest - lowest;
+  return lowest + scale16(beatsin, rangewidth);
+}
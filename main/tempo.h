@@ -0,0 +1,53 @@
+/**@file
+ *
+ * This file contains function headers for tempo.cpp
+ * along with the state of the system tempo clock.
+ *
+**/
+
+#ifndef TEMPO_H
+#define TEMPO_H
+
+#include <FastLED.h>
+#include "envelope.h"
+
+/// The shortest time between two onsets, in ms. Caps tracking at 240 BPM.
+#define TEMPO_MIN_INTERVAL 250
+
+/// How long the clock stays locked without hearing an onset, in ms.
+#define TEMPO_TIMEOUT 4000
+
+/// The tracked tempo is folded into this range by doubling or halving.
+#define TEMPO_MIN_BPM 80
+#define TEMPO_MAX_BPM 160
+
+/// How many consistent onsets it takes to lock on to a tempo.
+#define TEMPO_LOCK_CONFIDENCE 3
+
+/// @brief The state of the system tempo clock.
+///
+/// Phase is counted in beats, as 16.16 fixed point. The upper
+/// 16 bits count whole beats and the lower 16 bits hold the
+/// position inside the current beat.
+typedef struct{
+
+  uint32_t phase = 0;         /// Beats elapsed, in 16.16.
+  accum88 bpm = 120 << 8;     /// The tracked tempo, in Q8.8 BPM.
+  uint32_t last_update = 0;   /// The time of the last update, in ms.
+  uint32_t last_onset = 0;    /// The time of the last onset, in ms.
+  uint8_t confidence = 0;     /// Count of recent onsets that matched the tempo.
+  bool above = false;         /// If the volume was above the onset threshold last update.
+  Envelope floor;             /// Slow average of the volume onsets are measured against.
+
+} Tempo_Clock;
+
+void setup_tempo();
+void update_tempo(double volume, uint32_t now);
+bool tempo_locked();
+accum88 tempo_bpm();
+uint16_t tempo_beat16(accum88 beats_per_minute, uint32_t timebase = 0);
+uint8_t tempo_beat8(accum88 beats_per_minute, uint32_t timebase = 0);
+uint16_t tempo_beatsin16(accum88 beats_per_minute, uint16_t lowest = 0, uint16_t highest = 65535,
+                         uint32_t timebase = 0, uint16_t phase_offset = 0);
+
+#endif
@@ -0,0 +1,522 @@
+/** @file
+  *
+  * Host benchmarks for the render path. Run with "make bench".
+  *
+  * Each benchmark times the firmware's code against the code it
+  * replaced, on the same input. Host timings only show relative
+  * costs. The ESP32 has no SIMD or double FPU and much smaller
+  * caches, so absolute numbers there differ a lot.
+  *
+*/
+
+#include <FastLED.h>
+#include <chrono>
+#include <thread>
+#include <stdio.h>
+#include "nanolux_types.h"
+#include "storage.h"
+#include "parallel_render.h"
+#include "compositor.h"
+#include "palette.h"
+#include "blur.h"
+#include "filterbank.h"
+#include "noise_field.h"
+
+/// @brief Runs (fn) until about 200 ms have passed.
+/// @returns The average time one call took, in ns.
+template <typename Fn>
+static double time_ns(Fn fn){
+
+  typedef std::chrono::steady_clock clock;
+
+  // Warm up caches and the worker thread first.
+  for (int i = 0; i < 10; i++) fn();
+
+  long calls = 0;
+  clock::time_point start = clock::now();
+  double elapsed = 0;
+
+  while (elapsed < 2e8) {
+    for (int i = 0; i < 10; i++) fn();
+    calls += 10;
+    elapsed = std::chrono::duration<double, std::nano>(clock::now() - start).count();
+  }
+
+  return elapsed / calls;
+}
+
+/// @brief Stops the compiler from optimizing a result away.
+static volatile uint32_t sink;
+
+/************************************************
+*
+* Parallel dispatch
+*
+************************************************/
+
+/// The LED buffers the dispatch benchmark renders into.
+static CRGB segments[PATTERN_LIMIT][MAX_LEDS];
+
+/// The number of LEDs each segment renders.
+static int segment_len;
+
+/// @brief A stand-in pattern with about the per-pixel cost of
+/// the noise and trail patterns.
+static void render_segment(int index, void * ctx){
+  CRGB * leds = segments[index];
+  float phase = index * 0.7f + (float) (uintptr_t) ctx;
+
+  for (int i = 0; i < segment_len; i++) {
+    float x = sinf(i * 0.05f + phase) + 0.5f * sinf(i * 0.13f - phase);
+    uint8_t v = (uint8_t) (96 + 60 * x);
+    leds[i] = CRGB(v, scale8(v, 180), scale8(v, 60));
+  }
+}
+
+/// @brief Does nothing, to time the dispatch alone.
+static void empty_job(int index, void * ctx){}
+
+/// @brief Times rendering split-mode segments one after another,
+/// then across the two threads of parallel_for().
+static void bench_parallel_dispatch(){
+
+  printf("\nparallel_for() dispatch, %d segments, %u host threads:\n",
+         PATTERN_LIMIT, std::thread::hardware_concurrency());
+
+  const int lens[] = {15, 60, 375};
+  for (int len : lens) {
+    segment_len = len;
+
+    double serial = time_ns([]{
+      for (int i = 0; i < PATTERN_LIMIT; i++) render_segment(i, nullptr);
+    });
+    double parallel = time_ns([]{ parallel_for(render_segment, nullptr, PATTERN_LIMIT); });
+
+    printf("  %4d LEDs/segment: serial %8.0f ns, parallel %8.0f ns, speedup %.2fx\n",
+           len, serial, parallel, serial / parallel);
+  }
+
+  double overhead = time_ns([]{ parallel_for(empty_job, nullptr, 2); });
+  printf("  empty dispatch: %.0f ns\n", overhead);
+}
+
+/************************************************
+*
+* Compositor
+*
+************************************************/
+
+/// Pattern buffers, and the smoothed output each path writes to.
+static CRGB sources[2][MAX_LEDS];
+static CRGB smoothed_old[MAX_LEDS];
+static CRGB smoothed_new[MAX_LEDS];
+
+/// @brief The old float brightness pass.
+static void old_scale(CRGB * arr, int len, uint8_t factor){
+  float scale_factor = ((float) factor) / 255;
+  for (int i = 0; i < len; i++) {
+    arr[i].r *= scale_factor;
+    arr[i].g *= scale_factor;
+    arr[i].b *= scale_factor;
+  }
+}
+
+/// @brief The old blend pass, used for both layering and smoothing.
+static void old_layering(const CRGB * a, const CRGB * b, CRGB * out, int len, uint8_t amount){
+  for (int i = 0; i < len; i++)
+    out[i] = blend(a[i], b[i], amount);
+}
+
+/// @brief The old split-mode segment: copy, scale, then smooth.
+static void old_segment(int len, uint8_t brightness, uint8_t smoothing){
+  static CRGB tmp[MAX_LEDS];
+  memcpy(tmp, sources[0], sizeof(CRGB) * len);
+  old_scale(tmp, len, brightness);
+  old_layering(smoothed_old, tmp, smoothed_old, len, 255 - smoothing);
+}
+
+/// @brief The old two-pattern layering: copy and scale both,
+/// layer them, then smooth.
+static void old_stack(int len, uint8_t brightness, uint8_t alpha, uint8_t smoothing){
+  static CRGB temps[2][MAX_LEDS];
+  static CRGB layered[MAX_LEDS];
+  for (int i = 0; i < 2; i++) {
+    memcpy(temps[i], sources[i], sizeof(CRGB) * len);
+    old_scale(temps[i], len, brightness);
+  }
+  old_layering(temps[0], temps[1], layered, len, alpha);
+  old_layering(smoothed_old, layered, smoothed_old, len, 255 - smoothing);
+}
+
+/// @brief Returns the largest channel difference between the two outputs.
+static int max_difference(int len){
+  int most = 0;
+  for (int i = 0; i < len; i++)
+    for (int c = 0; c < 3; c++)
+      most = max(most, abs(smoothed_old[i][c] - smoothed_new[i][c]));
+  return most;
+}
+
+/// @brief Times composite_segment() and composite_stack() against
+/// the copy, scale and blend passes they replaced.
+static void bench_compositor(){
+
+  printf("\ncompositor vs copy + scale + blend passes:\n");
+
+  uint32_t seed = 1;
+  for (int i = 0; i < 2; i++)
+    for (int j = 0; j < MAX_LEDS; j++) {
+      seed = seed * 1664525 + 1013904223;
+      sources[i][j] = CRGB(seed >> 24, seed >> 16, seed >> 8);
+    }
+
+  typedef struct{ uint8_t brightness, smoothing; } Case;
+  const Case cases[] = { {255, 0}, {180, 100} };
+  const int lens[] = {60, 300, MAX_LEDS};
+
+  for (const Case & c : cases) {
+    for (int len : lens) {
+      Pixel_View view;
+      view.leds = sources[0];
+      view.len = len;
+
+      Layer layers[2];
+      for (int i = 0; i < 2; i++) {
+        layers[i].view.leds = sources[i];
+        layers[i].view.len = len;
+        layers[i].brightness = c.brightness;
+      }
+      layers[1].opacity = 128;
+
+      memset(smoothed_old, 0, sizeof(smoothed_old));
+      memset(smoothed_new, 0, sizeof(smoothed_new));
+      double seg_old = time_ns([&]{ old_segment(len, c.brightness, c.smoothing); });
+      double seg_new = time_ns([&]{ composite_segment(smoothed_new, len, &view, c.brightness, c.smoothing); });
+      int seg_diff = max_difference(len);
+
+      memset(smoothed_old, 0, sizeof(smoothed_old));
+      memset(smoothed_new, 0, sizeof(smoothed_new));
+      double stack_old = time_ns([&]{ old_stack(len, c.brightness, 128, c.smoothing); });
+      double stack_new = time_ns([&]{ composite_stack(smoothed_new, len, layers, 2, c.smoothing); });
+      int stack_diff = max_difference(len);
+
+      printf("  brightness %3d, smoothing %3d, %4d LEDs:\n", c.brightness, c.smoothing, len);
+      printf("    segment:    old %8.0f ns, new %8.0f ns, speedup %.2fx, max diff %d\n",
+             seg_old, seg_new, seg_old / seg_new, seg_diff);
+      printf("    two layers: old %8.0f ns, new %8.0f ns, speedup %.2fx, max diff %d\n",
+             stack_old, stack_new, stack_old / stack_new, stack_diff);
+    }
+  }
+}
+
+/************************************************
+*
+* Palette and hue tables
+*
+************************************************/
+
+/// The gradient the palette benchmark draws, from palettes.h.
+DECLARE_GRADIENT_PALETTE(GMT_hot_gp);
+
+/// The strip the palette benchmarks draw into.
+static CRGB strip[MAX_LEDS];
+
+/// @brief Prints how many pixels per second two ways of coloring
+/// a strip reach.
+static void print_rate(const char * name, double old_ns, double new_ns){
+  printf("  %-26s old %6.1f Mpx/s, new %6.1f Mpx/s, speedup %.2fx\n", name,
+         MAX_LEDS / old_ns * 1e3, MAX_LEDS / new_ns * 1e3, old_ns / new_ns);
+}
+
+/// @brief Times palette_lut() and hue_color() against the
+/// ColorFromPalette() and hsv2rgb_rainbow() calls they replaced.
+static void bench_palettes(){
+
+  printf("\npalette and hue tables, %d LEDs per frame:\n", MAX_LEDS);
+
+  setup_palettes();
+
+  // The palette patterns used to build a 16 color palette from the
+  // gradient and blend between its entries for every pixel.
+  static CRGBPalette16 hot16 = GMT_hot_gp;
+  const CRGB * hot = palette_lut(PALETTE_HOT);
+
+  double old_ns = time_ns([]{
+    for (int i = 0; i < MAX_LEDS; i++) strip[i] = ColorFromPalette(hot16, i * 7);
+    sink += strip[MAX_LEDS / 2].r;
+  });
+  double new_ns = time_ns([hot]{
+    for (int i = 0; i < MAX_LEDS; i++) strip[i] = hot[(uint8_t) (i * 7)];
+    sink += strip[MAX_LEDS / 2].r;
+  });
+  print_rate("palette:", old_ns, new_ns);
+
+  old_ns = time_ns([]{
+    for (int i = 0; i < MAX_LEDS; i++) hsv2rgb_rainbow(CHSV(i * 3, 255, 255), strip[i]);
+    sink += strip[MAX_LEDS / 2].r;
+  });
+  new_ns = time_ns([]{
+    for (int i = 0; i < MAX_LEDS; i++) strip[i] = hue_color(i * 3);
+    sink += strip[MAX_LEDS / 2].r;
+  });
+  print_rate("hue, full value:", old_ns, new_ns);
+
+  old_ns = time_ns([]{
+    for (int i = 0; i < MAX_LEDS; i++) hsv2rgb_rainbow(CHSV(i * 3, 255, i), strip[i]);
+    sink += strip[MAX_LEDS / 2].r;
+  });
+  new_ns = time_ns([]{
+    for (int i = 0; i < MAX_LEDS; i++) strip[i] = hue_color(i * 3, i);
+    sink += strip[MAX_LEDS / 2].r;
+  });
+  print_rate("hue, varying value:", old_ns, new_ns);
+
+  // The hue table should give exactly the colors it replaced.
+  int mismatches = 0;
+  for (int hue = 0; hue < 256; hue++)
+    for (int value = 0; value < 256; value++) {
+      CRGB expected;
+      hsv2rgb_rainbow(CHSV(hue, 255, value), expected);
+      if (hue_color(hue, value) != expected) mismatches++;
+    }
+  printf("  hue_color() differs from hsv2rgb_rainbow() for %d of 65536 colors\n", mismatches);
+}
+
+/************************************************
+*
+* Blur
+*
+************************************************/
+
+/// @brief Fills the strip with random colors.
+static void fill_random(int len){
+  uint32_t seed = 7;
+  for (int i = 0; i < len; i++) {
+    seed = seed * 1664525 + 1013904223;
+    strip[i] = CRGB(seed >> 24, seed >> 16, seed >> 8);
+  }
+}
+
+/// @brief Times box_blur() against the blur1d() passes it
+/// replaced in bands config 2, and one box pass against blur1d(80).
+static void bench_blur(){
+
+  printf("\nbox_blur() vs blur1d():\n");
+
+  const int lens[] = {60, 300, MAX_LEDS};
+  for (int len : lens) {
+
+    // Refill every call, so every pass blurs the same pixels.
+    double refill = time_ns([len]{ fill_random(len); });
+
+    double chained = time_ns([len]{
+      fill_random(len);
+      for (int p = 0; p < 5; p++) blur1d(strip, len, 50);
+    }) - refill;
+    double box = time_ns([len]{
+      fill_random(len);
+      box_blur(strip, len, 1, 2);
+    }) - refill;
+
+    double single = time_ns([len]{
+      fill_random(len);
+      blur1d(strip, len, 80);
+    }) - refill;
+    double box_single = time_ns([len]{
+      fill_random(len);
+      box_blur(strip, len, 1, 1);
+    }) - refill;
+
+    printf("  %4d LEDs: 5x blur1d(50) %7.0f ns, box_blur(1, 2) %7.0f ns, speedup %.2fx\n",
+           len, chained, box, chained / box);
+    printf("             blur1d(80)    %7.0f ns, box_blur(1, 1) %7.0f ns, speedup %.2fx\n",
+           single, box_single, single / box_single);
+  }
+}
+
+/************************************************
+*
+* Filterbank
+*
+************************************************/
+
+extern Filterbank_Kernel filterbank_kernel;
+
+/// @brief Times filterbank_apply() against multiplying the same
+/// kernel as a dense matrix, at the FFT sizes the firmware runs.
+static void bench_filterbank(){
+
+  printf("\nfilterbank_apply() vs a dense kernel matrix:\n");
+
+  static double magnitudes[512];
+  static double out[FILTERBANK_MAX_BANDS];
+  static float dense[FILTERBANK_MAX_BANDS][256];
+
+  for (int i = 0; i < 512; i++) magnitudes[i] = (i * 37) % 200;
+
+  const uint16_t fft_sizes[] = {128, 256};
+  const uint8_t band_counts[] = {16, 24, 32};
+
+  for (uint16_t fft_size : fft_sizes) {
+    for (uint8_t bands : band_counts) {
+      filterbank_init(bands, fft_size, SAMPLING_FREQUENCY);
+      const Filterbank_Kernel * k = &filterbank_kernel;
+      int nyquist_bin = fft_size / 2;
+
+      memset(dense, 0, sizeof(dense));
+      const float * w = k->weights;
+      int weights = 0;
+      for (int b = 0; b < k->bands; b++) {
+        for (int i = 0; i < k->bin_count[b]; i++)
+          dense[b][k->first_bin[b] + i] = w[i];
+        w += k->bin_count[b];
+        weights += k->bin_count[b];
+      }
+
+      double dense_ns = time_ns([k, nyquist_bin]{
+        for (int b = 0; b < k->bands; b++) {
+          float acc = 0;
+          for (int i = 0; i < nyquist_bin; i++) acc += (float) magnitudes[i] * dense[b][i];
+          out[b] = acc;
+        }
+        sink += out[0];
+      });
+      double sparse_ns = time_ns([]{
+        filterbank_apply(magnitudes, out);
+        sink += out[0];
+      });
+
+      printf("  FFT %3d, %2d bands, %3d weights: dense %6.0f ns, sparse %5.0f ns, speedup %.2fx\n",
+             fft_size, k->bands, weights, dense_ns, sparse_ns, dense_ns / sparse_ns);
+    }
+  }
+}
+
+/************************************************
+*
+* Noise field
+*
+************************************************/
+
+/// @brief Evaluates the noise at every pixel, like fill_noise16(),
+/// but for any strip length.
+///
+/// fill_noise16() stops computing noise after 255 pixels, so this
+/// stands in for it on long strips. It matches fill_noise16()
+/// exactly up to 255 pixels and 31 octaves.
+///
+/// From octave 32 on, fill_noise16() shifts the noise by 32 bits
+/// or more, which is undefined. Both x86 and the ESP32 wrap the
+/// shift count, so full noise is added again. Octaves past 16 are
+/// dropped here instead, as no defined shift changes the result.
+static void fill_noise_full(CRGB * leds, int len, uint8_t octaves, uint16_t x, int scale,
+                            uint8_t hue_octaves, uint16_t hue_x, int hue_scale,
+                            uint16_t time, uint8_t hue_shift){
+
+  static uint8_t V[MAX_LEDS], H[MAX_LEDS];
+  memset(V, 0, len);
+  memset(H, 0, len);
+
+  octaves = min(octaves, (uint8_t) 16);
+  hue_octaves = min(hue_octaves, (uint8_t) 16);
+
+  uint32_t _xx = x, scx = scale;
+  for (int o = 0; o < octaves; o++, _xx <<= 1, scx <<= 1)
+    for (int i = 0; i < len; i++) {
+      uint32_t accum = (inoise16(_xx + i * scx, time) >> o) + (V[i] << 8);
+      V[i] = min(accum, (uint32_t) 65535) >> 8;
+    }
+
+  _xx = hue_x, scx = hue_scale;
+  for (int o = 0; o < hue_octaves; o++, _xx <<= 1, scx <<= 1)
+    for (int i = 0; i < len; i++)
+      H[i] = qadd8(H[i], inoise8(_xx + i * scx, time) >> o);
+
+  for (int i = 0; i < len; i++)
+    hsv2rgb_rainbow(CHSV(H[i] + hue_shift, 255, V[i]), leds[i]);
+}
+
+/// The noise settings of saturated(), by config.
+typedef struct{
+  const char * name;
+  uint8_t octaves;
+  int scale;
+  uint8_t hue_octaves;
+  uint16_t hue_x;
+  int hue_scale;
+  uint8_t hue_shift;
+} Noise_Settings;
+
+/// @brief Compares fill_noise_field() with a full evaluation of
+/// the noise, for accuracy and speed, on short and long strips.
+static void bench_noise_field(){
+
+  printf("\nfill_noise_field() vs fill_noise16():\n");
+
+  static CRGB reference[MAX_LEDS];
+
+  // Sanity check the stand-in against fill_noise16() itself.
+  fill_noise16(strip, 200, 1, 0, 300, 1, 100, 20, 1234, 50);
+  fill_noise_full(reference, 200, 1, 0, 300, 1, 100, 20, 1234, 50);
+  printf("  full evaluation %s fill_noise16() at 200 LEDs\n",
+         memcmp(strip, reference, 200 * sizeof(CRGB)) ? "DIFFERS FROM" : "matches");
+
+  const Noise_Settings settings[] = {
+    {"default",     1, 300, 1, 100, 20, 50},
+    {"hue octaves", 1, 300, 5, 100, 20, 50},
+    {"hue shift",  75, 230, 1, 150, 20, 75},
+  };
+  const int lengths[] = {200, 1500};
+
+  for (const Noise_Settings & n : settings) {
+    for (int len : lengths) {
+
+      // Accuracy, over a few seconds of animation.
+      int max_diff = 0;
+      long total_diff = 0, channels = 0;
+      for (uint16_t time = 0; time < 2000; time += 97) {
+        fill_noise_full(reference, len, n.octaves, 0, n.scale, n.hue_octaves, n.hue_x, n.hue_scale, time, n.hue_shift);
+        fill_noise_field(strip, len, n.octaves, 0, n.scale, n.hue_octaves, n.hue_x, n.hue_scale, time, n.hue_shift);
+        for (int i = 0; i < len; i++)
+          for (int c = 0; c < 3; c++) {
+            int d = abs(strip[i].raw[c] - reference[i].raw[c]);
+            max_diff = max(max_diff, d);
+            total_diff += d;
+            channels++;
+          }
+      }
+
+      double full_ns = time_ns([&n, len]{
+        fill_noise_full(reference, len, n.octaves, 0, n.scale, n.hue_octaves, n.hue_x, n.hue_scale, 1234, n.hue_shift);
+        sink += reference[0].r;
+      });
+      double field_ns = time_ns([&n, len]{
+        fill_noise_field(strip, len, n.octaves, 0, n.scale, n.hue_octaves, n.hue_x, n.hue_scale, 1234, n.hue_shift);
+        sink += strip[0].r;
+      });
+
+      printf("  %-11s %4d LEDs: full %8.0f ns, field %7.0f ns, speedup %5.1fx, "
+             "channel error max %3d mean %.2f\n",
+             n.name, len, full_ns, field_ns, full_ns / field_ns,
+             max_diff, (double) total_diff / channels);
+    }
+  }
+
+  double noise16_ns = time_ns([]{
+    fill_noise16(strip, 200, 1, 0, 300, 1, 100, 20, 1234, 50);
+    sink += strip[0].r;
+  });
+  printf("  fill_noise16() itself, default, 200 LEDs: %.0f ns\n", noise16_ns);
+}
+
+int main(){
+  setup_parallel_render();
+
+  bench_parallel_dispatch();
+  bench_compositor();
+  bench_palettes();
+  bench_blur();
+  bench_filterbank();
+  bench_noise_field();
+  return 0;
+}
@@ -0,0 +1,48 @@
+/**@file
+ *
+ * A minimal check macro for the host tests.
+ *
+ * Every failed check prints where it failed and is counted.
+ * Tests return check_result() from main(), so make stops on
+ * the first test with a failure.
+ *
+**/
+
+#ifndef CHECK_H
+#define CHECK_H
+
+#include <stdio.h>
+
+/// The number of checks that failed so far.
+static int check_failures = 0;
+
+/// @brief Fails the test, without stopping it, if (cond) is false.
+#define CHECK(cond) do { \
+    if (!(cond)) { \
+      printf("%s:%d: check failed: %s\n", __FILE__, __LINE__, #cond); \
+      check_failures++; \
+    } \
+  } while (0)
+
+/// @brief Fails the test if two integers differ, printing both.
+#define CHECK_EQ(a, b) do { \
+    long long check_a = (long long) (a); \
+    long long check_b = (long long) (b); \
+    if (check_a != check_b) { \
+      printf("%s:%d: check failed: %s == %s (%lld != %lld)\n", \
+             __FILE__, __LINE__, #a, #b, check_a, check_b); \
+      check_failures++; \
+    } \
+  } while (0)
+
+/// @brief Prints a summary and returns the exit code for main().
+inline int check_result(const char * name){
+  if (check_failures) {
+    printf("%s: %d check(s) failed\n", name, check_failures);
+    return 1;
+  }
+  printf("%s: ok\n", name);
+  return 0;
+}
+
+#endif
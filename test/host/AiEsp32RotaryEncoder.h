@@ -0,0 +1,6 @@
+/**@file
+ *
+ * A host stand-in for the rotary encoder library. The tested
+ * files only include it through nanolux_util.h.
+ *
+**/
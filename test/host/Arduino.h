@@ -0,0 +1,50 @@
+/**@file
+ *
+ * A host stand-in for the parts of the Arduino core the tested
+ * firmware files use.
+ *
+ * Time comes from a clock the tests can set, so timing-dependent
+ * code runs the same on every run.
+ *
+**/
+
+#ifndef HOST_ARDUINO_H
+#define HOST_ARDUINO_H
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <algorithm>
+
+using std::min;
+using std::max;
+
+#define IRAM_ATTR
+#define A3 39
+
+#define constrain(amt, low, high) ((amt) < (low) ? (low) : ((amt) > (high) ? (high) : (amt)))
+
+typedef uint8_t byte;
+
+/// The time millis() and micros() return, in microseconds.
+extern uint32_t host_time_us;
+
+inline unsigned long millis(){ return host_time_us / 1000; }
+inline unsigned long micros(){ return host_time_us; }
+
+inline long map(long x, long in_min, long in_max, long out_min, long out_max){
+  return (x - in_min) * (out_max - out_min) / (in_max - in_min) + out_min;
+}
+
+/// @brief Discards everything printed to it.
+struct Host_Serial{
+  void begin(long){}
+  template <typename T> void print(const T &){}
+  template <typename T> void println(const T &){}
+  void println(){}
+};
+
+extern Host_Serial Serial;
+
+#endif
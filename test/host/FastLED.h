@@ -0,0 +1,165 @@
+/**@file
+ *
+ * A host stand-in for the parts of FastLED the tested firmware
+ * files use.
+ *
+ * The math follows FastLED 3.4 built with FASTLED_SCALE8_FIXED,
+ * as on the ESP32, so results match the device bit for bit.
+ *
+**/
+
+#ifndef HOST_FASTLED_H
+#define HOST_FASTLED_H
+
+#include <Arduino.h>
+
+typedef uint8_t fract8;
+
+#define FASTLED_USING_NAMESPACE
+
+inline uint8_t scale8(uint8_t i, fract8 scale){
+  return ((uint16_t) i * (1 + (uint16_t) scale)) >> 8;
+}
+
+inline uint8_t scale8_video(uint8_t i, fract8 scale){
+  return (((int) i * (int) scale) >> 8) + ((i && scale) ? 1 : 0);
+}
+
+inline uint8_t qadd8(uint8_t i, uint8_t j){
+  unsigned int t = i + j;
+  return (t > 255) ? 255 : t;
+}
+
+inline uint8_t qsub8(uint8_t i, uint8_t j){
+  int t = i - j;
+  return (t < 0) ? 0 : t;
+}
+
+/// @brief A color in hue, saturation and value.
+struct CHSV{
+  union{
+    struct{ uint8_t hue, sat, val; };
+    struct{ uint8_t h, s, v; };
+    uint8_t raw[3];
+  };
+
+  CHSV() : hue(0), sat(0), val(0){}
+  CHSV(uint8_t ih, uint8_t is, uint8_t iv) : hue(ih), sat(is), val(iv){}
+};
+
+/// @brief A color in red, green and blue.
+struct CRGB{
+  union{
+    struct{
+      union{ uint8_t r; uint8_t red; };
+      union{ uint8_t g; uint8_t green; };
+      union{ uint8_t b; uint8_t blue; };
+    };
+    uint8_t raw[3];
+  };
+
+  CRGB() : r(0), g(0), b(0){}
+  CRGB(uint8_t ir, uint8_t ig, uint8_t ib) : r(ir), g(ig), b(ib){}
+  CRGB(uint32_t colorcode) : r(colorcode >> 16), g(colorcode >> 8), b(colorcode){}
+
+  uint8_t & operator[](uint8_t x){ return raw[x]; }
+  const uint8_t & operator[](uint8_t x) const { return raw[x]; }
+
+  CRGB & operator+=(const CRGB & rhs){
+    r = qadd8(r, rhs.r);
+    g = qadd8(g, rhs.g);
+    b = qadd8(b, rhs.b);
+    return *this;
+  }
+
+  CRGB & nscale8(uint8_t scaledown){
+    r = scale8(r, scaledown);
+    g = scale8(g, scaledown);
+    b = scale8(b, scaledown);
+    return *this;
+  }
+
+  bool operator==(const CRGB & rhs) const { return r == rhs.r && g == rhs.g && b == rhs.b; }
+  bool operator!=(const CRGB & rhs) const { return !(*this == rhs); }
+
+  enum HTMLColorCode{
+    Black = 0x000000,
+    Blue = 0x0000FF,
+    Green = 0x008000,
+    Red = 0xFF0000,
+    White = 0xFFFFFF,
+  };
+};
+
+/// @brief Blends two values, (amountOfB) of the way from a to b.
+inline uint8_t blend8(uint8_t a, uint8_t b, uint8_t amountOfB){
+  uint16_t partial = (a * (255 - amountOfB)) + a + (b * amountOfB) + b;
+  return partial >> 8;
+}
+
+/// @brief Blends (overlay) into (existing), (amountOfOverlay) of the way.
+inline CRGB & nblend(CRGB & existing, const CRGB & overlay, fract8 amountOfOverlay){
+  if (amountOfOverlay == 0) return existing;
+  if (amountOfOverlay == 255) return existing = overlay;
+
+  existing.r = blend8(existing.r, overlay.r, amountOfOverlay);
+  existing.g = blend8(existing.g, overlay.g, amountOfOverlay);
+  existing.b = blend8(existing.b, overlay.b, amountOfOverlay);
+  return existing;
+}
+
+/// @brief Returns a blend of two colors, (amountOfP2) of the way from p1 to p2.
+inline CRGB blend(const CRGB & p1, const CRGB & p2, fract8 amountOfP2){
+  CRGB nu(p1);
+  nblend(nu, p2, amountOfP2);
+  return nu;
+}
+
+uint16_t inoise16(uint32_t x, uint32_t y);
+uint8_t inoise8(uint16_t x, uint16_t y);
+void fill_noise16(CRGB * leds, int num_leds,
+                  uint8_t octaves, uint16_t x, int scale,
+                  uint8_t hue_octaves, uint16_t hue_x, int hue_scale,
+                  uint16_t time, uint8_t hue_shift);
+void blur1d(CRGB * leds, uint16_t numLeds, fract8 blur_amount);
+void hsv2rgb_rainbow(const CHSV & hsv, CRGB & rgb);
+void fill_gradient_RGB(CRGB * leds, uint16_t startpos, CRGB startcolor,
+                       uint16_t endpos, CRGB endcolor);
+
+typedef const uint8_t TProgmemRGBGradientPalette_byte;
+typedef const TProgmemRGBGradientPalette_byte * TProgmemRGBGradientPalette_bytes;
+typedef TProgmemRGBGradientPalette_bytes TProgmemRGBGradientPalettePtr;
+
+/// Defines a gradient palette: entries of index, red, green and
+/// blue, ending with index 255.
+#define DEFINE_GRADIENT_PALETTE(X) \
+  extern const TProgmemRGBGradientPalette_byte X[] =
+
+/// Declares a gradient palette defined in another file.
+#define DECLARE_GRADIENT_PALETTE(X) \
+  extern const TProgmemRGBGradientPalette_byte X[]
+
+/// @brief A 16 color palette, expanded from a gradient the way
+/// FastLED does.
+struct CRGBPalette16{
+  CRGB entries[16];
+
+  CRGBPalette16(TProgmemRGBGradientPalette_bytes progpal);
+  const CRGB & operator[](uint8_t x) const { return entries[x]; }
+};
+
+/// @brief A 256 color palette, expanded from a gradient.
+struct CRGBPalette256{
+  CRGB entries[256];
+
+  CRGBPalette256() {}
+  CRGBPalette256(TProgmemRGBGradientPalette_bytes progpal);
+  const CRGB & operator[](uint8_t x) const { return entries[x]; }
+};
+
+CRGB ColorFromPalette(const CRGBPalette16 & pal, uint8_t index, uint8_t brightness = 255);
+
+/// The color correction NanoLux uses for its strips.
+#define TypicalLEDStrip 0xFFB0F0
+
+#endif
@@ -0,0 +1,199 @@
+/** @file
+  *
+  * This file's definitions back the host stand-ins for the
+  * Arduino core and FastLED.
+  *
+*/
+
+#include <Arduino.h>
+#include <FastLED.h>
+
+uint32_t host_time_us = 0;
+
+Host_Serial Serial;
+
+/// @brief The same as FastLED's blur1d(). Each pixel keeps
+/// 255 - blur_amount of itself and spreads half of blur_amount
+/// to each neighbor.
+void blur1d(CRGB * leds, uint16_t numLeds, fract8 blur_amount){
+
+  uint8_t keep = 255 - blur_amount;
+  uint8_t seep = blur_amount >> 1;
+  CRGB carryover = CRGB::Black;
+
+  for (uint16_t i = 0; i < numLeds; ++i) {
+    CRGB cur = leds[i];
+    CRGB part = cur;
+    part.nscale8(seep);
+    cur.nscale8(keep);
+    cur += carryover;
+    if (i) leds[i - 1] += part;
+    leds[i] = cur;
+    carryover = part;
+  }
+}
+
+/// @brief The same as FastLED's hsv2rgb_rainbow(), with its default
+/// yellow and green options.
+void hsv2rgb_rainbow(const CHSV & hsv, CRGB & rgb){
+
+  uint8_t hue = hsv.hue;
+  uint8_t sat = hsv.sat;
+  uint8_t val = hsv.val;
+
+  uint8_t offset8 = (hue & 0x1F) << 3;
+  uint8_t third = scale8(offset8, 256 / 3);
+  uint8_t twothirds = scale8(offset8, (256 * 2) / 3);
+  uint8_t r, g, b;
+
+  if (!(hue & 0x80)) {
+    if (!(hue & 0x40)) {
+      if (!(hue & 0x20)) { r = 255 - third; g = third; b = 0; }
+      else               { r = 171; g = 85 + third; b = 0; }
+    } else {
+      if (!(hue & 0x20)) { r = 171 - twothirds; g = 170 + third; b = 0; }
+      else               { r = 0; g = 255 - third; b = third; }
+    }
+  } else {
+    if (!(hue & 0x40)) {
+      if (!(hue & 0x20)) { r = 0; g = 171 - twothirds; b = 85 + twothirds; }
+      else               { r = third; g = 0; b = 255 - third; }
+    } else {
+      if (!(hue & 0x20)) { r = 85 + third; g = 0; b = 171 - third; }
+      else               { r = 170 + third; g = 0; b = 85 - third; }
+    }
+  }
+
+  if (sat != 255) {
+    if (sat == 0) {
+      r = 255; g = 255; b = 255;
+    } else {
+      uint8_t desat = 255 - sat;
+      desat = scale8_video(desat, desat);
+      uint8_t satscale = 255 - desat;
+      r = scale8(r, satscale) + desat;
+      g = scale8(g, satscale) + desat;
+      b = scale8(b, satscale) + desat;
+    }
+  }
+
+  if (val != 255) {
+    val = scale8_video(val, val);
+    r = scale8(r, val);
+    g = scale8(g, val);
+    b = scale8(b, val);
+  }
+
+  rgb = CRGB(r, g, b);
+}
+
+/// @brief The same as FastLED's fill_gradient_RGB() between two points.
+void fill_gradient_RGB(CRGB * leds, uint16_t startpos, CRGB startcolor,
+                       uint16_t endpos, CRGB endcolor){
+
+  if (endpos < startpos) {
+    uint16_t t = endpos;
+    CRGB tc = endcolor;
+    endcolor = startcolor;
+    endpos = startpos;
+    startpos = t;
+    startcolor = tc;
+  }
+
+  int16_t divisor = (endpos - startpos) ? endpos - startpos : 1;
+  int16_t rdelta = (int16_t) ((endcolor.r - startcolor.r) << 7) / divisor * 2;
+  int16_t gdelta = (int16_t) ((endcolor.g - startcolor.g) << 7) / divisor * 2;
+  int16_t bdelta = (int16_t) ((endcolor.b - startcolor.b) << 7) / divisor * 2;
+
+  uint16_t r = startcolor.r << 8;
+  uint16_t g = startcolor.g << 8;
+  uint16_t b = startcolor.b << 8;
+  for (uint16_t i = startpos; i <= endpos; ++i) {
+    leds[i] = CRGB(r >> 8, g >> 8, b >> 8);
+    r += rdelta;
+    g += gdelta;
+    b += bdelta;
+  }
+}
+
+/// @brief Reads gradient entry (i) as its index and color.
+static uint8_t gradient_entry(TProgmemRGBGradientPalette_bytes gp, int i, CRGB * color){
+  *color = CRGB(gp[4 * i + 1], gp[4 * i + 2], gp[4 * i + 3]);
+  return gp[4 * i];
+}
+
+CRGBPalette16::CRGBPalette16(TProgmemRGBGradientPalette_bytes progpal){
+
+  CRGB color;
+  uint16_t count = 0;
+  while (gradient_entry(progpal, count++, &color) != 255);
+
+  int8_t last_slot = -1;
+  CRGB rgbstart;
+  gradient_entry(progpal, 0, &rgbstart);
+
+  int indexstart = 0;
+  for (int i = 1; indexstart < 255; i++) {
+    CRGB rgbend;
+    int indexend = gradient_entry(progpal, i, &rgbend);
+    uint8_t istart8 = indexstart / 16;
+    uint8_t iend8 = indexend / 16;
+
+    if (count < 16) {
+      if (istart8 <= last_slot && last_slot < 15) {
+        istart8 = last_slot + 1;
+        if (iend8 < istart8) iend8 = istart8;
+      }
+      last_slot = iend8;
+    }
+
+    fill_gradient_RGB(entries, istart8, rgbstart, iend8, rgbend);
+    indexstart = indexend;
+    rgbstart = rgbend;
+  }
+}
+
+CRGBPalette256::CRGBPalette256(TProgmemRGBGradientPalette_bytes progpal){
+
+  CRGB rgbstart;
+  gradient_entry(progpal, 0, &rgbstart);
+
+  int indexstart = 0;
+  for (int i = 1; indexstart < 255; i++) {
+    CRGB rgbend;
+    int indexend = gradient_entry(progpal, i, &rgbend);
+    fill_gradient_RGB(entries, indexstart, rgbstart, indexend, rgbend);
+    indexstart = indexend;
+    rgbstart = rgbend;
+  }
+}
+
+/// @brief The same as FastLED's ColorFromPalette() with LINEARBLEND.
+CRGB ColorFromPalette(const CRGBPalette16 & pal, uint8_t index, uint8_t brightness){
+
+  uint8_t hi4 = index >> 4;
+  uint8_t lo4 = index & 0x0F;
+  CRGB c = pal[hi4];
+
+  if (lo4) {
+    const CRGB & next = pal[(hi4 + 1) & 0x0F];
+    uint8_t f2 = lo4 << 4;
+    uint8_t f1 = 255 - f2;
+    c.r = scale8(c.r, f1) + scale8(next.r, f2);
+    c.g = scale8(c.g, f1) + scale8(next.g, f2);
+    c.b = scale8(c.b, f1) + scale8(next.b, f2);
+  }
+
+  if (brightness != 255) {
+    if (brightness) {
+      brightness++;
+      c.r = scale8(c.r, brightness);
+      c.g = scale8(c.g, brightness);
+      c.b = scale8(c.b, brightness);
+    } else {
+      c = CRGB(0, 0, 0);
+    }
+  }
+
+  return c;
+}
@@ -0,0 +1,185 @@
+/** @file
+  *
+  * This file's functions stand in for the 2D noise functions of
+  * FastLED's noise.cpp, built the way the ESP32 builds them
+  * (FASTLED_NOISE_FIXED, FASTLED_SCALE8_FIXED), so host results
+  * match the device bit for bit.
+  *
+*/
+
+#include <FastLED.h>
+#include <string.h>
+
+/// Ken Perlin's permutation table, with the first entry repeated.
+static const uint8_t p[] = {
+    151, 160, 137,  91,  90,  15, 131,  13, 201,  95,  96,  53, 194, 233,   7, 225,
+    140,  36, 103,  30,  69, 142,   8,  99,  37, 240,  21,  10,  23, 190,   6, 148,
+    247, 120, 234,  75,   0,  26, 197,  62,  94, 252, 219, 203, 117,  35,  11,  32,
+     57, 177,  33,  88, 237, 149,  56,  87, 174,  20, 125, 136, 171, 168,  68, 175,
+     74, 165,  71, 134, 139,  48,  27, 166,  77, 146, 158, 231,  83, 111, 229, 122,
+     60, 211, 133, 230, 220, 105,  92,  41,  55,  46, 245,  40, 244, 102, 143,  54,
+     65,  25,  63, 161,   1, 216,  80,  73, 209,  76, 132, 187, 208,  89,  18, 169,
+    200, 196, 135, 130, 116, 188, 159,  86, 164, 100, 109, 198, 173, 186,   3,  64,
+     52, 217, 226, 250, 124, 123,   5, 202,  38, 147, 118, 126, 255,  82,  85, 212,
+    207, 206,  59, 227,  47,  16,  58,  17, 182, 189,  28,  42, 223, 183, 170, 213,
+    119, 248, 152,   2,  44, 154, 163,  70, 221, 153, 101, 155, 167,  43, 172,   9,
+    129,  22,  39, 253,  19,  98, 108, 110,  79, 113, 224, 232, 178, 185, 112, 104,
+    218, 246,  97, 228, 251,  34, 242, 193, 238, 210, 144,  12, 191, 179, 162, 241,
+     81,  51, 145, 235, 249,  14, 239, 107,  49, 192, 214,  31, 181, 199, 106, 157,
+    184,  84, 204, 176, 115, 121,  50,  45, 127,   4, 150, 254, 138, 236, 205,  93,
+    222, 114,  67,  29,  24,  72, 243, 141, 128, 195,  78,  66, 215,  61, 156, 180,
+    151};
+
+static inline uint16_t scale16(uint16_t i, uint16_t scale){
+  return ((uint32_t) i * (1 + (uint32_t) scale)) / 65536;
+}
+
+static inline int16_t avg15(int16_t i, int16_t j){
+  return ((int32_t) ((int32_t) i + (int32_t) j) >> 1) + (i & 0x1);
+}
+
+static inline int8_t avg7(int8_t i, int8_t j){
+  return ((i + j) >> 1) + (i & 0x1);
+}
+
+static inline uint8_t ease8InOutQuad(uint8_t i){
+  uint8_t j = (i & 0x80) ? 255 - i : i;
+  uint8_t jj2 = scale8(j, j) << 1;
+  return (i & 0x80) ? 255 - jj2 : jj2;
+}
+
+static inline uint16_t ease16InOutQuad(uint16_t i){
+  uint16_t j = (i & 0x8000) ? 65535 - i : i;
+  uint16_t jj2 = scale16(j, j) << 1;
+  return (i & 0x8000) ? 65535 - jj2 : jj2;
+}
+
+static inline int16_t lerp15by16(int16_t a, int16_t b, uint16_t frac){
+  if (b > a) return a + scale16(b - a, frac);
+  return a - scale16(a - b, frac);
+}
+
+static inline int8_t lerp7by8(int8_t a, int8_t b, uint8_t frac){
+  if (b > a) return a + scale8(b - a, frac);
+  return a - scale8(a - b, frac);
+}
+
+static inline int16_t grad16(uint8_t hash, int16_t x, int16_t y){
+  hash = hash & 7;
+  int16_t u, v;
+  if (hash < 4) { u = x; v = y; } else { u = y; v = x; }
+  if (hash & 1) u = -u;
+  if (hash & 2) v = -v;
+  return avg15(u, v);
+}
+
+static inline int8_t grad8(uint8_t hash, int8_t x, int8_t y){
+  int8_t u, v;
+  if (hash & 4) { u = y; v = x; } else { u = x; v = y; }
+  if (hash & 1) u = -u;
+  if (hash & 2) v = -v;
+  return avg7(u, v);
+}
+
+static int16_t inoise16_raw(uint32_t x, uint32_t y){
+  uint8_t X = x >> 16;
+  uint8_t Y = y >> 16;
+
+  uint8_t A = p[X] + Y;
+  uint8_t AA = p[A];
+  uint8_t AB = p[(uint8_t) (A + 1)];
+  uint8_t B = p[(uint8_t) (X + 1)] + Y;
+  uint8_t BA = p[B];
+  uint8_t BB = p[(uint8_t) (B + 1)];
+
+  uint16_t u = x & 0xFFFF;
+  uint16_t v = y & 0xFFFF;
+
+  int16_t xx = (u >> 1) & 0x7FFF;
+  int16_t yy = (v >> 1) & 0x7FFF;
+  uint16_t N = 0x8000L;
+
+  u = ease16InOutQuad(u);
+  v = ease16InOutQuad(v);
+
+  int16_t X1 = lerp15by16(grad16(p[AA], xx, yy), grad16(p[BA], xx - N, yy), u);
+  int16_t X2 = lerp15by16(grad16(p[AB], xx, yy - N), grad16(p[BB], xx - N, yy - N), u);
+  return lerp15by16(X1, X2, v);
+}
+
+uint16_t inoise16(uint32_t x, uint32_t y){
+  uint32_t pan = (int32_t) inoise16_raw(x, y) + 17308L;
+  pan *= 484L;
+  return pan >> 8;
+}
+
+static int8_t inoise8_raw(uint16_t x, uint16_t y){
+  uint8_t X = x >> 8;
+  uint8_t Y = y >> 8;
+
+  uint8_t A = p[X] + Y;
+  uint8_t AA = p[A];
+  uint8_t AB = p[(uint8_t) (A + 1)];
+  uint8_t B = p[(uint8_t) (X + 1)] + Y;
+  uint8_t BA = p[B];
+  uint8_t BB = p[(uint8_t) (B + 1)];
+
+  uint8_t u = x;
+  uint8_t v = y;
+
+  int8_t xx = ((uint8_t) x >> 1) & 0x7F;
+  int8_t yy = ((uint8_t) y >> 1) & 0x7F;
+  uint8_t N = 0x80;
+
+  u = ease8InOutQuad(u);
+  v = ease8InOutQuad(v);
+
+  int8_t X1 = lerp7by8(grad8(p[AA], xx, yy), grad8(p[BA], xx - N, yy), u);
+  int8_t X2 = lerp7by8(grad8(p[AB], xx, yy - N), grad8(p[BB], xx - N, yy - N), u);
+  return lerp7by8(X1, X2, v);
+}
+
+uint8_t inoise8(uint16_t x, uint16_t y){
+  int8_t n = inoise8_raw(x, y) + 64;
+  return qadd8(n, n);
+}
+
+/// @brief The same as FastLED's fill_noise16(), including the byte
+/// its point count is cut to.
+void fill_noise16(CRGB * leds, int num_leds,
+                  uint8_t octaves, uint16_t x, int scale,
+                  uint8_t hue_octaves, uint16_t hue_x, int hue_scale,
+                  uint16_t time, uint8_t hue_shift){
+
+  uint8_t V[num_leds];
+  uint8_t H[num_leds];
+  memset(V, 0, num_leds);
+  memset(H, 0, num_leds);
+
+  uint8_t num_points = num_leds;
+
+  uint32_t _xx = x;
+  uint32_t scx = scale;
+  for (int o = 0; o < octaves; ++o) {
+    for (int i = 0, xx = _xx; i < num_points; ++i, xx += scx) {
+      uint32_t accum = inoise16(xx, time) >> o;
+      accum += V[i] << 8;
+      if (accum > 65535) accum = 65535;
+      V[i] = accum >> 8;
+    }
+    _xx <<= 1;
+    scx <<= 1;
+  }
+
+  _xx = hue_x;
+  scx = hue_scale;
+  for (int o = 0; o < hue_octaves; ++o) {
+    for (int i = 0, xx = _xx; i < num_points; ++i, xx += scx)
+      H[i] = qadd8(H[i], inoise8(xx, time) >> o);
+    _xx <<= 1;
+    scx <<= 1;
+  }
+
+  for (int i = 0; i < num_leds; ++i)
+    hsv2rgb_rainbow(CHSV(H[i] + hue_shift, 255, V[i]), leds[i]);
+}
@@ -0,0 +1,181 @@
+/** @file
+  *
+  * Host tests for splitting frames between output channels and
+  * sending them through a sink.
+  *
+*/
+
+#include <FastLED.h>
+#include <vector>
+#include "channels.h"
+#include "sk9822.h"
+#include "check.h"
+
+#define CHANNELS 3
+
+/// @brief A sink that keeps a copy of everything sent through it.
+typedef struct{
+
+  std::vector<uint8_t> buffers[CHANNELS]; /// The buffer handed out per channel.
+  std::vector<uint8_t> sent[CHANNELS];    /// The bytes sent per channel.
+  int sends[CHANNELS];                    /// The number of sends per channel.
+  int finishes;                           /// The number of finish() calls.
+  bool finished_before_send;              /// If any send came after finish().
+
+} Recorder;
+
+static uint8_t * record_acquire(uint8_t ch, size_t size, void * ctx){
+  Recorder * rec = (Recorder *) ctx;
+  rec->buffers[ch].assign(size, 0xAA);
+  return rec->buffers[ch].data();
+}
+
+static void record_send(uint8_t ch, const uint8_t * data, size_t size, void * ctx){
+  Recorder * rec = (Recorder *) ctx;
+  rec->sent[ch].assign(data, data + size);
+  rec->sends[ch]++;
+  if (rec->finishes) rec->finished_before_send = true;
+}
+
+static void record_finish(void * ctx){
+  ((Recorder *) ctx)->finishes++;
+}
+
+/// @brief Returns a sink that records into (rec).
+static Channel_Sink recorder_sink(Recorder * rec){
+  *rec = Recorder();
+  Channel_Sink sink = { record_acquire, record_send, record_finish, rec };
+  return sink;
+}
+
+/// @brief Fills a frame with a different color at every LED.
+static void fill_frame(CRGB * leds, uint16_t len){
+  for (int i = 0; i < len; i++)
+    leds[i] = CRGB(i & 0xFF, i >> 8, 0x33);
+}
+
+/// @brief Checks a channel was sent the LEDs [offset, offset + len) of a frame.
+static void check_sent(const Recorder * rec, uint8_t ch, const CRGB * frame, uint16_t offset, uint16_t len){
+
+  CHECK_EQ(rec->sends[ch], 1);
+  CHECK_EQ(rec->sent[ch].size(), sk9822_frame_size(len));
+
+  for (int i = 0; i < len; i++) {
+    const uint8_t * led = &rec->sent[ch][SK9822_START_BYTES + SK9822_LED_BYTES * i];
+    CHECK_EQ(led[1], frame[offset + i].b);
+    CHECK_EQ(led[2], frame[offset + i].g);
+    CHECK_EQ(led[3], frame[offset + i].r);
+  }
+}
+
+/// @brief Channels are laid out back to back, and a length of 0
+/// takes the remainder.
+static void test_split(){
+
+  Channel_Span spans[CHANNELS];
+
+  const uint16_t fixed[CHANNELS] = {10, 20, 5};
+  CHECK_EQ(split_channels(fixed, CHANNELS, 100, spans), 3);
+  CHECK_EQ(spans[0].offset, 0);  CHECK_EQ(spans[0].length, 10);
+  CHECK_EQ(spans[1].offset, 10); CHECK_EQ(spans[1].length, 20);
+  CHECK_EQ(spans[2].offset, 30); CHECK_EQ(spans[2].length, 5);
+
+  // The remainder channel takes the rest and leaves nothing after it.
+  const uint16_t remainder[CHANNELS] = {10, 0, 7};
+  CHECK_EQ(split_channels(remainder, CHANNELS, 100, spans), 2);
+  CHECK_EQ(spans[1].offset, 10); CHECK_EQ(spans[1].length, 90);
+  CHECK_EQ(spans[2].offset, 100); CHECK_EQ(spans[2].length, 0);
+
+  // Lengths past the end of the strip are cut short.
+  const uint16_t long_first[CHANNELS] = {80, 50, 0};
+  CHECK_EQ(split_channels(long_first, CHANNELS, 100, spans), 2);
+  CHECK_EQ(spans[0].length, 80);
+  CHECK_EQ(spans[1].offset, 80); CHECK_EQ(spans[1].length, 20);
+  CHECK_EQ(spans[2].length, 0);
+}
+
+/// @brief Spans shrink for frames shorter than the strip.
+static void test_channel_length(){
+
+  Channel_Span span;
+  span.offset = 10;
+  span.length = 20;
+
+  CHECK_EQ(channel_length(&span, 100), 20);
+  CHECK_EQ(channel_length(&span, 25), 15);
+  CHECK_EQ(channel_length(&span, 10), 0);
+  CHECK_EQ(channel_length(&span, 5), 0);
+}
+
+/// @brief Every channel is sent its own part of the frame at its
+/// own length, and empty channels are not sent at all.
+static void test_send(){
+
+  CRGB frame[100];
+  fill_frame(frame, 100);
+
+  Channel_Span spans[CHANNELS];
+  const uint16_t lengths[CHANNELS] = {17, 0, 5};
+  split_channels(lengths, CHANNELS, 100, spans);
+
+  Recorder rec;
+  Channel_Sink sink = recorder_sink(&rec);
+  send_channels(frame, 100, spans, CHANNELS, SK9822_MAX_BRIGHTNESS, CRGB(255, 255, 255), &sink);
+
+  check_sent(&rec, 0, frame, 0, 17);
+  check_sent(&rec, 1, frame, 17, 83);
+  CHECK_EQ(rec.sends[2], 0);
+
+  CHECK_EQ(rec.finishes, 1);
+  CHECK(!rec.finished_before_send);
+}
+
+/// @brief A zero-length channel between two others is skipped,
+/// and the channel after it still gets its own span.
+static void test_send_zero_length_channel(){
+
+  CRGB frame[40];
+  fill_frame(frame, 40);
+
+  Channel_Span spans[CHANNELS];
+  spans[0].offset = 0;  spans[0].length = 16;
+  spans[1].offset = 16; spans[1].length = 0;
+  spans[2].offset = 16; spans[2].length = 24;
+
+  Recorder rec;
+  Channel_Sink sink = recorder_sink(&rec);
+  send_channels(frame, 40, spans, CHANNELS, 1, CRGB(255, 255, 255), &sink);
+
+  check_sent(&rec, 0, frame, 0, 16);
+  CHECK_EQ(rec.sends[1], 0);
+  check_sent(&rec, 2, frame, 16, 24);
+  CHECK_EQ(rec.finishes, 1);
+}
+
+/// @brief A frame shorter than the strip cuts the last channels short.
+static void test_send_short_frame(){
+
+  CRGB frame[100];
+  fill_frame(frame, 100);
+
+  Channel_Span spans[CHANNELS];
+  const uint16_t lengths[CHANNELS] = {30, 30, 0};
+  split_channels(lengths, CHANNELS, 100, spans);
+
+  Recorder rec;
+  Channel_Sink sink = recorder_sink(&rec);
+  send_channels(frame, 45, spans, CHANNELS, 1, CRGB(255, 255, 255), &sink);
+
+  check_sent(&rec, 0, frame, 0, 30);
+  check_sent(&rec, 1, frame, 30, 15);
+  CHECK_EQ(rec.sends[2], 0);
+}
+
+int main(){
+  test_split();
+  test_channel_length();
+  test_send();
+  test_send_zero_length_channel();
+  test_send_short_frame();
+  return check_result("test_channels");
+}
@@ -0,0 +1,331 @@
+/** @file
+  *
+  * Host tests for density_formant(), comparing it with the
+  * nested-loop version it replaced.
+  *
+  * The FFT frames are synthesized: voiced vowels with three
+  * formants, noise, pure tones and silence. Each is windowed and
+  * transformed the way the analysis stage does, so vReal holds
+  * the full mirrored magnitude spectrum.
+  *
+  * No recordings from the microphone are available, so a second
+  * set of frames mimics what the ADC delivers instead: 12-bit
+  * samples around the microphone's DC offset, with quantization,
+  * hum and clipping. Equivalence is only shown on these
+  * synthesized inputs.
+  *
+*/
+
+#include <FastLED.h>
+#include <chrono>
+#include <vector>
+#include "nanolux_types.h"
+#include "envelope.h"
+#include "filterbank.h"
+#include "ext_analysis.h"
+#include "check.h"
+
+// The analysis globals ext_analysis.cpp reads and writes.
+double volume;
+double peak;
+double vReal[SAMPLES];
+Running_Average formant_history[3];
+double formants[3];
+double fbs[5];
+VowelSounds current_vowel;
+double log_bands[FILTERBANK_MAX_BANDS];
+
+/// The frequency one FFT bin spans, in Hz.
+static const double BIN_HZ = (double) SAMPLING_FREQUENCY / SAMPLES;
+
+/// @brief A small deterministic random generator.
+static uint32_t rng_state = 12345;
+static double random_unit(){
+  rng_state = rng_state * 1664525 + 1013904223;
+  return (rng_state >> 8) / 16777216.0;
+}
+
+/// @brief Windows a signal and stores its magnitude spectrum.
+/// @param signal SAMPLES samples of the signal.
+/// @param out    Set to SAMPLES magnitudes, mirrored above Nyquist.
+static void magnitude_spectrum(const double * signal, double * out){
+  for (int k = 0; k < SAMPLES; k++) {
+    double re = 0, im = 0;
+    for (int n = 0; n < SAMPLES; n++) {
+      double w = 0.54 - 0.46 * cos(2 * M_PI * n / (SAMPLES - 1));
+      re += w * signal[n] * cos(2 * M_PI * k * n / SAMPLES);
+      im -= w * signal[n] * sin(2 * M_PI * k * n / SAMPLES);
+    }
+    out[k] = sqrt(re * re + im * im);
+  }
+}
+
+/// @brief Synthesizes a voiced vowel from a pitch and three formants.
+static void vowel(double * signal, double pitch, const double * formant_hz, double level){
+  for (int n = 0; n < SAMPLES; n++) signal[n] = 0;
+
+  for (double f = pitch; f < SAMPLING_FREQUENCY / 2; f += pitch) {
+    double gain = 0;
+    for (int i = 0; i < 3; i++) {
+      double d = (f - formant_hz[i]) / (120 + 60 * i);
+      gain += 1.0 / (1 + d * d);
+    }
+    double phase = random_unit() * 2 * M_PI;
+    for (int n = 0; n < SAMPLES; n++)
+      signal[n] += level * gain * sin(2 * M_PI * f * n / SAMPLING_FREQUENCY + phase);
+  }
+}
+
+/// @brief Turns a signal into the 12-bit samples the ADC reads,
+/// around the microphone's DC offset, with mains hum and clipping.
+static void adc_samples(double * signal){
+  for (int n = 0; n < SAMPLES; n++) {
+    double v = 1850 + signal[n] + 25 * sin(2 * M_PI * 60 * n / SAMPLING_FREQUENCY)
+             + (random_unit() - 0.5) * 12;
+    signal[n] = constrain(round(v), 0, 4095);
+  }
+}
+
+/// @brief Builds every test frame.
+/// @param adc If the frames should look like raw ADC reads.
+static std::vector<std::vector<double>> make_frames(bool adc){
+
+  std::vector<std::vector<double>> frames;
+  double signal[SAMPLES];
+  std::vector<double> spectrum(SAMPLES);
+
+  const double vowels[5][3] = {
+    {730, 1090, 2440}, {530, 1840, 2480}, {270, 2290, 3010},
+    {570, 840, 2410},  {300, 870, 2240},
+  };
+
+  for (int i = 0; i < 400; i++) {
+    int kind = i % 8;
+
+    if (kind < 5) {
+      double pitch = 90 + random_unit() * 160;
+      double level = 5 + random_unit() * 60;
+      vowel(signal, pitch, vowels[kind], level);
+    } else if (kind == 5) {
+      double level = random_unit() * 400;
+      for (int n = 0; n < SAMPLES; n++) signal[n] = (random_unit() - 0.5) * level;
+    } else if (kind == 6) {
+      double f = 200 + random_unit() * 4000;
+      for (int n = 0; n < SAMPLES; n++) signal[n] = 800 * sin(2 * M_PI * f * n / SAMPLING_FREQUENCY);
+    } else {
+      for (int n = 0; n < SAMPLES; n++) signal[n] = 0;
+    }
+
+    if (adc) adc_samples(signal);
+    magnitude_spectrum(signal, spectrum.data());
+    frames.push_back(spectrum);
+  }
+
+  return frames;
+}
+
+/// @brief The bins the old nested-loop density_formant() picked.
+/// @param spectrum The magnitude spectrum.
+/// @returns The bin of every window dense enough to be a formant, in
+/// the order the old version found them.
+///
+/// The old version recounted every 20-bin window from scratch and
+/// scanned the mirrored upper half too. It stored the first two hits
+/// in F0 and F1, and overwrote F2 with every hit after that. It also
+/// stored the magnitude vReal[i] rather than the bin's frequency, so
+/// hits are compared by bin.
+static std::vector<int> old_formant_bins(const double * spectrum){
+
+  std::vector<int> hits;
+  int left = 10;
+  int right = 10;
+  int len = SAMPLES - right;
+
+  for (int i = left + 3; i < len; i += right) {
+    int count = 0;
+    for (int j = i - left; j < i + right; j++) {
+      if (spectrum[j] > 200) count += 1;
+    }
+
+    if (count > 12) {
+      hits.push_back(i);
+      i += right;
+    }
+  }
+
+  return hits;
+}
+
+/// Smoothing arrays of the old version. It indexed them up to 21,
+/// past their 20 entries, so they are sized 22 here.
+static int F0arr[22], F1arr[22], F2arr[22];
+static int formant_pose = 0;
+
+/// @brief The old density_formant(), kept whole for timing.
+static double * old_density_formant(){
+  int F0 = 0;
+  int F1 = 0;
+  int F2 = 0;
+  int count = 0;
+  int left = 10;
+  int right = 10;
+  int len = (sizeof(vReal)/sizeof(vReal[0])) - right;
+
+  for (int i = left + 3; i < len; i += (int) (1.0*right)) {
+    count = 0;
+    for (int j = i - left; j < i + right; j++) {
+      if (vReal[j] > 200) {
+        count += 1;
+      }
+    }
+
+    if (count > 12) {
+      if (F0 == 0) {
+        F0 = vReal[i];
+        F0arr[formant_pose] = F0;
+      }
+      else if (F0 != 0 && F1 == 0) {
+        F1 = vReal[i];
+        F1arr[formant_pose] = F1;
+      }
+      else {
+        F2 = vReal[i];
+        F2arr[formant_pose] = F2;
+      }
+      i += right;
+    }
+  }
+
+  if (formant_pose == 21)
+    formant_pose = 0;
+
+  formant_pose += 1;
+  F0 = 0;
+  F1 = 0;
+  F2 = 0;
+
+  for (int z = 0; z < 22; z++) {
+    F0 += F0arr[z];
+    F1 += F1arr[z];
+    F2 += F2arr[z];
+  }
+
+  F0 /= 22;
+  F1 /= 22;
+  F2 /= 22;
+
+  double* temp_formants = new double[3];
+  temp_formants[0] = F0;
+  temp_formants[1] = F1;
+  temp_formants[2] = F2;
+  return temp_formants;
+}
+
+/// @brief Returns the bin a formant history was last pushed.
+static int last_pushed(const Running_Average * avg){
+  int slot = (avg->pos + avg->size - 1) % avg->size;
+  return avg->samples[slot];
+}
+
+/// @brief Every formant density_formant() pushes is the bin the old
+/// version found, and every formant it stores is the mean of its
+/// history in Hz.
+static void test_matches_old_path(const char * name, const std::vector<std::vector<double>> & frames){
+
+  for (int f = 0; f < 3; f++) running_average_init(&formant_history[f], RUNNING_AVERAGE_DEFAULT);
+
+  int with_formants = 0;
+  int old_f2_overwritten = 0;
+
+  for (size_t n = 0; n < frames.size(); n++) {
+    memcpy(vReal, frames[n].data(), sizeof(vReal));
+
+    std::vector<int> hits = old_formant_bins(vReal);
+
+    // The new version only scans below Nyquist and keeps the first three.
+    std::vector<int> expected;
+    for (int bin : hits)
+      if (bin < SAMPLES / 2 - 10 && expected.size() < 3) expected.push_back(bin);
+    if (hits.size() > 3 || (hits.size() == 3 && expected.size() < 3)) old_f2_overwritten++;
+
+    uint8_t pos_before[3];
+    for (int f = 0; f < 3; f++) pos_before[f] = formant_history[f].pos;
+
+    density_formant();
+
+    for (int f = 0; f < 3; f++) {
+      const Running_Average * avg = &formant_history[f];
+      bool pushed = avg->pos != pos_before[f];
+      CHECK_EQ(pushed, f < (int) expected.size());
+      if (pushed) CHECK_EQ(last_pushed(avg), expected[f]);
+
+      double sum = 0;
+      for (int i = 0; i < avg->size; i++) sum += avg->samples[i];
+      CHECK(fabs(formants[f] - sum / avg->size * BIN_HZ) < 1e-9);
+    }
+
+    if (!expected.empty()) with_formants++;
+  }
+
+  // The frames should exercise both found and missing formants.
+  CHECK(with_formants > 50);
+  CHECK(with_formants < (int) frames.size());
+
+  printf("density_formant, %s frames: %d of %zu had formants; the old F2 was "
+         "overwritten by a later or mirrored hit in %d\n",
+         name, with_formants, frames.size(), old_f2_overwritten);
+}
+
+/// @brief Runs (fn) on every frame, copied into vReal first.
+/// @returns The best time over several runs, in ns per frame.
+template <typename Fn>
+static double time_frames(const std::vector<std::vector<double>> & frames, Fn fn){
+
+  const int reps = 50;
+  double best = 1e30;
+
+  for (int run = 0; run < 5; run++) {
+    auto start = std::chrono::steady_clock::now();
+    for (int r = 0; r < reps; r++) {
+      for (size_t n = 0; n < frames.size(); n++) {
+        memcpy(vReal, frames[n].data(), sizeof(vReal));
+        fn();
+      }
+    }
+    auto end = std::chrono::steady_clock::now();
+    double ns = std::chrono::duration<double, std::nano>(end - start).count();
+    best = fmin(best, ns / (reps * frames.size()));
+  }
+
+  return best;
+}
+
+/// @brief Times the old and new versions over every frame,
+/// including their smoothing. The time to copy each frame into
+/// vReal is measured on its own and left out.
+static void time_against_old_path(const std::vector<std::vector<double>> & frames){
+
+  static volatile int sink = 0;
+
+  double copy_ns = time_frames(frames, []{ sink += (int) vReal[5]; });
+  double old_ns = time_frames(frames, []{
+    double * result = old_density_formant();
+    sink += (int) result[0];
+    delete[] result;
+  }) - copy_ns;
+  double new_ns = time_frames(frames, []{
+    density_formant();
+    sink += (int) formants[0];
+  }) - copy_ns;
+
+  printf("density_formant: old %.0f ns/frame, new %.0f ns/frame\n",
+         old_ns, new_ns);
+}
+
+int main(){
+  std::vector<std::vector<double>> frames = make_frames(false);
+  test_matches_old_path("clean", frames);
+  test_matches_old_path("ADC", make_frames(true));
+  time_against_old_path(frames);
+  return check_result("test_density_formant");
+}
@@ -0,0 +1,108 @@
+/** @file
+  *
+  * Host tests for the log-spaced filterbank kernel.
+  *
+*/
+
+#include <FastLED.h>
+#include "nanolux_types.h"
+#include "filterbank.h"
+#include "check.h"
+
+extern Filterbank_Kernel filterbank_kernel;
+
+/// @brief Returns the bin a band weighs the most.
+static int peak_bin(const Filterbank_Kernel * k, const float * w, int b){
+  int best = 0;
+  for (int i = 1; i < k->bin_count[b]; i++)
+    if (w[i] > w[best]) best = i;
+  return k->first_bin[b] + best;
+}
+
+/// @brief Every band reads only bins from FILTERBANK_FIRST_BIN to
+/// below Nyquist, peaks on a bin of its own, and has weights that
+/// sum to one.
+static void test_kernel(uint8_t bands, uint16_t fft_size){
+
+  filterbank_init(bands, fft_size, SAMPLING_FREQUENCY);
+  const Filterbank_Kernel * k = &filterbank_kernel;
+
+  int nyquist_bin = fft_size / 2;
+  CHECK_EQ(k->bands, min((int) bands, nyquist_bin - FILTERBANK_FIRST_BIN));
+  CHECK_EQ(filterbank_band_count(), k->bands);
+
+  const float * w = k->weights;
+  int used = 0;
+  int previous_peak = -1;
+
+  for (int b = 0; b < k->bands; b++) {
+    CHECK(k->bin_count[b] > 0);
+    CHECK(k->first_bin[b] >= FILTERBANK_FIRST_BIN);
+    CHECK(k->first_bin[b] + k->bin_count[b] <= nyquist_bin);
+
+    float sum = 0;
+    for (int i = 0; i < k->bin_count[b]; i++) {
+      CHECK(w[i] > 0);
+      sum += w[i];
+    }
+    CHECK(fabs(sum - 1) < 1e-5);
+
+    int peak = peak_bin(k, w, b);
+    CHECK(peak > previous_peak);
+    previous_peak = peak;
+
+    w += k->bin_count[b];
+    used += k->bin_count[b];
+  }
+
+  CHECK(used <= FILTERBANK_MAX_WEIGHTS);
+}
+
+/// @brief A flat spectrum comes out flat, and the DC bins below
+/// FILTERBANK_FIRST_BIN never reach any band.
+static void test_apply(uint8_t bands, uint16_t fft_size){
+
+  filterbank_init(bands, fft_size, SAMPLING_FREQUENCY);
+
+  double magnitudes[512];
+  double out[FILTERBANK_MAX_BANDS];
+
+  for (int i = 0; i < fft_size; i++) magnitudes[i] = 100;
+  filterbank_apply(magnitudes, out);
+  for (int b = 0; b < filterbank_band_count(); b++)
+    CHECK(fabs(out[b] - 100) < 1e-3);
+
+  for (int i = 0; i < fft_size; i++) magnitudes[i] = (i < FILTERBANK_FIRST_BIN) ? 5000 : 0;
+  filterbank_apply(magnitudes, out);
+  for (int b = 0; b < filterbank_band_count(); b++)
+    CHECK_EQ(out[b], 0);
+}
+
+/// @brief At the default 24 bands and FFT 128, the lowest band
+/// starts at FILTERBANK_FIRST_BIN and the bands fill the spectrum.
+static void test_default_layout(){
+
+  filterbank_init(FILTERBANK_BANDS, SAMPLES, SAMPLING_FREQUENCY);
+  const Filterbank_Kernel * k = &filterbank_kernel;
+
+  CHECK_EQ(k->bands, FILTERBANK_BANDS);
+  CHECK_EQ(k->first_bin[0], FILTERBANK_FIRST_BIN);
+
+  int last = k->bands - 1;
+  CHECK(k->first_bin[last] + k->bin_count[last] >= MAX_FREQUENCY * SAMPLES / SAMPLING_FREQUENCY - 1);
+}
+
+int main(){
+  const uint8_t band_counts[] = {16, 24, 32};
+  const uint16_t fft_sizes[] = {64, 128, 256, 512};
+
+  for (uint8_t bands : band_counts) {
+    for (uint16_t fft_size : fft_sizes) {
+      test_kernel(bands, fft_size);
+      test_apply(bands, fft_size);
+    }
+  }
+
+  test_default_layout();
+  return check_result("test_filterbank");
+}
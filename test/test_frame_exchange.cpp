@@ -0,0 +1,246 @@
+/** @file
+  *
+  * Host tests for the frame hand-over between the loop and the
+  * output task, and for blending between frames.
+  *
+*/
+
+#include <FastLED.h>
+#include <thread>
+#include <mutex>
+#include "frame_exchange.h"
+#include "output.h"
+#include "check.h"
+
+#define LEN 32
+
+/// Backing memory for every exchange in these tests.
+static CRGB frames[FRAME_EXCHANGE_BUFFERS * LEN];
+
+/// @brief Fills a frame with one color that encodes (id).
+static void fill_id(CRGB * leds, uint16_t len, uint16_t id){
+  for (int i = 0; i < len; i++)
+    leds[i] = CRGB(id >> 8, id & 0xFF, 0x5A);
+}
+
+/// @brief Returns the id a frame was filled with, or -1 if its LEDs differ.
+static int frame_id(const CRGB * leds, uint16_t len){
+  for (int i = 1; i < len; i++)
+    if (leds[i] != leds[0]) return -1;
+  return (leds[0].r << 8) | leds[0].g;
+}
+
+/// @brief Checks the five frame pointers are still five different buffers.
+static void check_buffers_distinct(const Frame_Exchange * fx){
+  CRGB * p[FRAME_EXCHANGE_BUFFERS] = { fx->back, fx->pending, fx->from, fx->to, fx->sent };
+  for (int i = 0; i < FRAME_EXCHANGE_BUFFERS; i++)
+    for (int j = i + 1; j < FRAME_EXCHANGE_BUFFERS; j++)
+      CHECK(p[i] != p[j]);
+}
+
+/// @brief Blends hit both ends exactly and round in between.
+static void test_blend(){
+
+  CRGB a[2] = { CRGB(0, 100, 255), CRGB(10, 10, 10) };
+  CRGB b[2] = { CRGB(255, 50, 0), CRGB(10, 10, 10) };
+  CRGB out[2];
+
+  CHECK(frame_blend(a, b, out, 2, 0));
+  CHECK(out[0] == a[0] && out[1] == a[1]);
+  CHECK(!frame_blend(a, b, out, 2, 0));
+
+  CHECK(frame_blend(a, b, out, 2, 65536));
+  CHECK(out[0] == b[0] && out[1] == b[1]);
+
+  frame_blend(a, b, out, 2, 32768);
+  CHECK_EQ(out[0].r, 128);
+  CHECK_EQ(out[0].g, 75);
+  CHECK_EQ(out[0].b, 128);
+  CHECK(out[1] == a[1]);
+}
+
+/// @brief When the task runs between frames, it takes every frame
+/// exactly once, in order.
+static void test_every_frame_taken_once(){
+
+  Frame_Exchange fx;
+  memset(frames, 0, sizeof(frames));
+  frame_exchange_init(&fx, frames, LEN);
+
+  uint16_t len;
+  uint32_t arrival;
+  CHECK(!frame_take(&fx, &len, &arrival));
+
+  for (uint16_t id = 1; id <= 100; id++) {
+    fill_id(fx.back, LEN, id);
+    frame_publish(&fx, LEN, id * 40);
+    check_buffers_distinct(&fx);
+
+    // The task wakes several times per loop, and only the first
+    // wake picks the frame up.
+    for (int tick = 0; tick < 4; tick++) {
+      bool taken = frame_take(&fx, &len, &arrival);
+      CHECK_EQ(taken, tick == 0);
+      if (!taken) continue;
+
+      CHECK_EQ(len, LEN);
+      CHECK_EQ(arrival, id * 40);
+      CHECK_EQ(frame_id(fx.to, LEN), id);
+      check_buffers_distinct(&fx);
+    }
+  }
+}
+
+/// @brief A frame replaced before the task wakes is never shown,
+/// and its buffer goes back to the loop.
+static void test_newest_frame_wins(){
+
+  Frame_Exchange fx;
+  memset(frames, 0, sizeof(frames));
+  frame_exchange_init(&fx, frames, LEN);
+
+  fill_id(fx.back, LEN, 1);
+  frame_publish(&fx, LEN, 0);
+  CRGB * first = fx.pending;
+
+  fill_id(fx.back, LEN, 2);
+  frame_publish(&fx, LEN, 10);
+  CHECK(fx.back == first);
+
+  uint16_t len;
+  uint32_t arrival;
+  CHECK(frame_take(&fx, &len, &arrival));
+  CHECK_EQ(frame_id(fx.to, LEN), 2);
+  CHECK_EQ(arrival, 10);
+  CHECK(!frame_take(&fx, &len, &arrival));
+}
+
+/// @brief With the loop and task on their own threads, the task
+/// never sees a frame twice, out of order or half written.
+static void test_threaded_hand_over(){
+
+  Frame_Exchange fx;
+  memset(frames, 0, sizeof(frames));
+  frame_exchange_init(&fx, frames, LEN);
+
+  std::mutex pending_lock;
+  const uint16_t last = 20000;
+  int taken = 0;
+  int errors = 0;
+
+  std::thread task([&](){
+    int previous = 0;
+    while (previous != last) {
+      uint16_t len;
+      uint32_t arrival;
+
+      pending_lock.lock();
+      bool got = frame_take(&fx, &len, &arrival);
+      pending_lock.unlock();
+
+      if (!got) {
+        std::this_thread::yield();
+        continue;
+      }
+
+      int id = frame_id(fx.to, LEN);
+      if (id <= previous || (uint32_t) id != arrival) errors++;
+      previous = id;
+      taken++;
+    }
+  });
+
+  for (uint16_t id = 1; id <= last; id++) {
+    fill_id(fx.back, LEN, id);
+
+    pending_lock.lock();
+    frame_publish(&fx, LEN, id);
+    pending_lock.unlock();
+  }
+
+  task.join();
+
+  CHECK_EQ(errors, 0);
+  CHECK(taken > 0);
+  check_buffers_distinct(&fx);
+}
+
+/// @brief Unchanged frames are skipped until OUTPUT_REFRESH_MS
+/// forces a resend.
+static void test_skip_and_refresh(){
+
+  Frame_Exchange fx;
+  memset(frames, 0, sizeof(frames));
+  frame_exchange_init(&fx, frames, LEN);
+
+  uint16_t len = 0;
+  uint32_t arrival = 0;
+
+  fill_id(fx.back, LEN, 7);
+  frame_publish(&fx, LEN, 1000);
+  bool taken = frame_take(&fx, &len, &arrival);
+
+  // A new strip length snaps straight to the frame and sends it.
+  CHECK(frame_advance(&fx, taken, len, arrival, 1000));
+  CHECK_EQ(fx.sent_len, LEN);
+  CHECK_EQ(frame_id(fx.sent, LEN), 7);
+
+  // Nothing changes, so nothing is sent until the refresh is due.
+  uint32_t now = 1000;
+  int sends = 0;
+  for (; now < 1000 + OUTPUT_REFRESH_MS; now += 8)
+    sends += frame_advance(&fx, false, 0, 0, now);
+  CHECK_EQ(sends, 0);
+
+  CHECK(frame_advance(&fx, false, 0, 0, now));
+  CHECK(!frame_advance(&fx, false, 0, 0, now + 8));
+
+  // Handing over an identical frame sends nothing either.
+  fill_id(fx.back, LEN, 7);
+  frame_publish(&fx, LEN, now + 16);
+  taken = frame_take(&fx, &len, &arrival);
+  CHECK(taken);
+  CHECK(!frame_advance(&fx, taken, len, arrival, now + 16));
+  CHECK(!frame_advance(&fx, false, 0, 0, now + 24));
+}
+
+/// @brief A new frame is blended into over the time between the
+/// last two frames, and every step of the blend is sent.
+static void test_blend_over_interval(){
+
+  Frame_Exchange fx;
+  memset(frames, 0, sizeof(frames));
+  frame_exchange_init(&fx, frames, LEN);
+
+  uint16_t len = 0;
+  uint32_t arrival = 0;
+
+  fill_id(fx.back, LEN, 0);
+  frame_publish(&fx, LEN, 1000);
+  bool taken = frame_take(&fx, &len, &arrival);
+  frame_advance(&fx, taken, len, arrival, 1000);
+
+  fill_id(fx.back, LEN, 200);
+  frame_publish(&fx, LEN, 1040);
+  taken = frame_take(&fx, &len, &arrival);
+
+  // Halfway through the 40 ms interval, the blend is halfway there.
+  CHECK(frame_advance(&fx, taken, len, arrival, 1060));
+  CHECK_EQ(fx.interval, 40);
+  CHECK_EQ(fx.sent[0].g, 100);
+
+  CHECK(frame_advance(&fx, false, 0, 0, 1080));
+  CHECK_EQ(frame_id(fx.sent, LEN), 200);
+
+  CHECK(!frame_advance(&fx, false, 0, 0, 1090));
+}
+
+int main(){
+  test_blend();
+  test_every_frame_taken_once();
+  test_newest_frame_wins();
+  test_threaded_hand_over();
+  test_skip_and_refresh();
+  test_blend_over_interval();
+  return check_result("test_frame_exchange");
+}
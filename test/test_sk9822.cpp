@@ -0,0 +1,105 @@
+/** @file
+  *
+  * Host tests for sk9822_encode().
+  *
+*/
+
+#include <FastLED.h>
+#include "sk9822.h"
+#include "check.h"
+
+/// Large enough for any frame these tests encode.
+static uint8_t out[1024];
+
+/// @brief Checks the start frame and that the end frame is all zeros.
+/// @param len  The number of LEDs encoded.
+/// @param size The size sk9822_encode() returned.
+static void check_framing(uint16_t len, size_t size){
+
+  CHECK_EQ(size, sk9822_frame_size(len));
+
+  for (int i = 0; i < SK9822_START_BYTES; i++)
+    CHECK_EQ(out[i], 0);
+
+  // Four latch bytes, then one byte per 16 LEDs, rounded up.
+  size_t end = SK9822_START_BYTES + SK9822_LED_BYTES * len;
+  CHECK_EQ(size - end, 4 + (len + 15) / 16);
+
+  for (size_t i = end; i < size; i++)
+    CHECK_EQ(out[i], 0);
+}
+
+/// @brief The end frame grows by one byte per 16 LEDs.
+static void test_end_frame_length(){
+
+  const uint16_t lens[] = {0, 1, 16, 17};
+  const size_t end_bytes[] = {4, 5, 5, 6};
+  CRGB leds[17];
+
+  for (int t = 0; t < 4; t++) {
+    memset(out, 0xAA, sizeof(out));
+    size_t size = sk9822_encode(leds, lens[t], SK9822_MAX_BRIGHTNESS, CRGB(255, 255, 255), out, sizeof(out));
+
+    check_framing(lens[t], size);
+    CHECK_EQ(size, SK9822_START_BYTES + SK9822_LED_BYTES * lens[t] + end_bytes[t]);
+  }
+}
+
+/// @brief Every LED starts with 0xE0 and the 5-bit brightness.
+static void test_led_header(){
+
+  CRGB leds[3];
+
+  for (int brightness = 0; brightness <= SK9822_MAX_BRIGHTNESS; brightness++) {
+    size_t size = sk9822_encode(leds, 3, brightness, CRGB(255, 255, 255), out, sizeof(out));
+    check_framing(3, size);
+
+    for (int i = 0; i < 3; i++)
+      CHECK_EQ(out[SK9822_START_BYTES + SK9822_LED_BYTES * i], 0xE0 | brightness);
+  }
+
+  // Brightness past 5 bits is clamped rather than spilling into the header.
+  sk9822_encode(leds, 1, 200, CRGB(255, 255, 255), out, sizeof(out));
+  CHECK_EQ(out[SK9822_START_BYTES], 0xE0 | SK9822_MAX_BRIGHTNESS);
+}
+
+/// @brief Colors are sent blue, green, red, each scaled by the correction.
+static void test_color_order_and_correction(){
+
+  CRGB leds[2] = { CRGB(10, 20, 30), CRGB(255, 128, 1) };
+  CRGB correction(TypicalLEDStrip);
+
+  size_t size = sk9822_encode(leds, 2, 7, correction, out, sizeof(out));
+  check_framing(2, size);
+
+  for (int i = 0; i < 2; i++) {
+    const uint8_t * led = &out[SK9822_START_BYTES + SK9822_LED_BYTES * i];
+    CHECK_EQ(led[1], scale8(leds[i].b, correction.b));
+    CHECK_EQ(led[2], scale8(leds[i].g, correction.g));
+    CHECK_EQ(led[3], scale8(leds[i].r, correction.r));
+  }
+
+  // With no correction, the channels pass through unchanged.
+  sk9822_encode(leds, 2, 7, CRGB(255, 255, 255), out, sizeof(out));
+  CHECK_EQ(out[SK9822_START_BYTES + 1], 30);
+  CHECK_EQ(out[SK9822_START_BYTES + 2], 20);
+  CHECK_EQ(out[SK9822_START_BYTES + 3], 10);
+}
+
+/// @brief Nothing is written to a buffer that is too small.
+static void test_small_buffer(){
+
+  CRGB leds[4];
+  memset(out, 0xAA, sizeof(out));
+
+  CHECK_EQ(sk9822_encode(leds, 4, 31, CRGB(255, 255, 255), out, sk9822_frame_size(4) - 1), 0);
+  CHECK_EQ(out[0], 0xAA);
+}
+
+int main(){
+  test_end_frame_length();
+  test_led_header();
+  test_color_order_and_correction();
+  test_small_buffer();
+  return check_result("test_sk9822");
+}